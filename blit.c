@@ -0,0 +1,490 @@
+/*
+ * Copyright (c) 2021 Muvik Labs, LLC
+ * Distributed under the MIT license.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "blit.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SG_BLIT_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Porter-Duff "over" for premultiplied ARGB32 images on the
+ * opaque xRGB frame, in 8-bit sRGB like cairo:
+ *
+ * S = src * opacity
+ * dst = S + dst * (1 - S.alpha)
+ *
+ * with every product divided by 255 exactly, rounded.
+ */
+
+static uint32_t mul255(uint32_t a, uint32_t b)
+{
+    uint32_t t;
+    t = a * b + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+/* RGBA bytes to premultiplied ARGB32 */
+
+void sg_blit_premultiply(const uint8_t *rgba, uint32_t *dst, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint32_t a;
+        a = rgba[4*i + 3];
+        dst[i] = a << 24 |
+            mul255(rgba[4*i], a) << 16 |
+            mul255(rgba[4*i + 1], a) << 8 |
+            mul255(rgba[4*i + 2], a);
+    }
+}
+
+/*
+ * Finds the runs of a row that are not fully transparent,
+ * writing start and end pairs to runs, or only counting
+ * them if runs is NULL. Returns the number of runs, at most
+ * (n + 1) / 2.
+ */
+
+int sg_blit_runs(const uint32_t *pm, int n, int *runs)
+{
+    int i;
+    int nruns;
+
+    nruns = 0;
+    i = 0;
+
+    while (i < n) {
+        while (i < n && (pm[i] >> 24) == 0) i++;
+        if (i == n) break;
+        if (runs != NULL) runs[2*nruns] = i;
+        while (i < n && (pm[i] >> 24) != 0) i++;
+        if (runs != NULL) runs[2*nruns + 1] = i;
+        nruns++;
+    }
+
+    return nruns;
+}
+
+static void over_c(uint32_t *dst, const uint32_t *src, int n, int opacity)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint32_t s, d;
+        uint32_t a, ia;
+
+        s = src[i];
+
+        if (opacity < 255) {
+            s = mul255(s >> 24, opacity) << 24 |
+                mul255((s >> 16) & 0xff, opacity) << 16 |
+                mul255((s >> 8) & 0xff, opacity) << 8 |
+                mul255(s & 0xff, opacity);
+        }
+
+        a = s >> 24;
+
+        if (a == 255) {
+            dst[i] = s;
+            continue;
+        }
+
+        if (a == 0 && (s & 0xffffff) == 0) continue;
+
+        d = dst[i];
+        ia = 255 - a;
+
+        dst[i] = 0xff000000 |
+            (((s >> 16) & 0xff) + mul255((d >> 16) & 0xff, ia)) << 16 |
+            (((s >> 8) & 0xff) + mul255((d >> 8) & 0xff, ia)) << 8 |
+            ((s & 0xff) + mul255(d & 0xff, ia));
+    }
+}
+
+/*
+ * The four texels around (x, y), top left first. Texels off
+ * the image are transparent. Returns 0 when all four are off.
+ */
+
+static int texels(const uint32_t *src, int w, int h,
+                  int x, int y, uint32_t *t)
+{
+    const uint32_t *p;
+
+    if (x < -1 || x >= w || y < -1 || y >= h) return 0;
+
+    if (x >= 0 && x < w - 1 && y >= 0 && y < h - 1) {
+        p = &src[y * w + x];
+        t[0] = p[0];
+        t[1] = p[1];
+        t[2] = p[w];
+        t[3] = p[w + 1];
+        return 1;
+    }
+
+    t[0] = (x >= 0 && y >= 0) ? src[y * w + x] : 0;
+    t[1] = (x < w - 1 && y >= 0) ? src[y * w + x + 1] : 0;
+    t[2] = (x >= 0 && y < h - 1) ? src[(y + 1) * w + x] : 0;
+    t[3] = (x < w - 1 && y < h - 1) ? src[(y + 1) * w + x + 1] : 0;
+
+    return 1;
+}
+
+/* weights fx and fy are 0 to 255, of 256 */
+
+static uint32_t bilerp_c(const uint32_t *t, int fx, int fy)
+{
+    uint32_t out;
+    int sh;
+
+    out = 0;
+
+    for (sh = 0; sh < 32; sh += 8) {
+        uint32_t a, b;
+
+        a = (((t[0] >> sh) & 0xff) * (256 - fy) +
+             ((t[2] >> sh) & 0xff) * fy) >> 8;
+        b = (((t[1] >> sh) & 0xff) * (256 - fy) +
+             ((t[3] >> sh) & 0xff) * fy) >> 8;
+
+        out |= ((a * (256 - fx) + b * fx) >> 8) << sh;
+    }
+
+    return out;
+}
+
+/*
+ * Sample i is at u + i * du, v + i * dv, never stepped past
+ * the last one, so nothing overflows as long as the first and
+ * last samples are in range.
+ */
+
+static void sample_c(uint32_t *dst,
+                     const uint32_t *src, int w, int h,
+                     int32_t u, int32_t v,
+                     int32_t du, int32_t dv,
+                     int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint32_t t[4];
+        int32_t ui, vi;
+
+        ui = u + i * du;
+        vi = v + i * dv;
+
+        if (!texels(src, w, h, ui >> 16, vi >> 16, t)) {
+            dst[i] = 0;
+            continue;
+        }
+
+        dst[i] = bilerp_c(t, (ui >> 8) & 0xff, (vi >> 8) & 0xff);
+    }
+}
+
+#ifdef SG_BLIT_X86
+
+/* x * y / 255 on 16-bit lanes, rounded */
+
+__attribute__((target("sse2")))
+static __m128i mul255_sse2(__m128i x, __m128i y)
+{
+    __m128i t;
+    t = _mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+/* two pixels, unpacked to 16 bits per channel */
+
+__attribute__((target("sse2")))
+static __m128i over2_sse2(__m128i s, __m128i d, __m128i op)
+{
+    __m128i ia;
+
+    s = mul255_sse2(s, op);
+
+    /* 255 - alpha, copied to all four channels of each pixel */
+    ia = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+    ia = _mm_shufflehi_epi16(ia, _MM_SHUFFLE(3, 3, 3, 3));
+    ia = _mm_sub_epi16(_mm_set1_epi16(255), ia);
+
+    return _mm_add_epi16(s, mul255_sse2(d, ia));
+}
+
+__attribute__((target("sse2")))
+static void over_sse2(uint32_t *dst, const uint32_t *src, int n, int opacity)
+{
+    __m128i zero, op, opaque;
+    int i;
+
+    zero = _mm_setzero_si128();
+    op = _mm_set1_epi16(opacity);
+    opaque = _mm_set1_epi32(0xff000000);
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128i s, d;
+        __m128i lo, hi;
+
+        s = _mm_loadu_si128((const __m128i *)&src[i]);
+
+        /* fully transparent groups leave dst alone */
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xffff) continue;
+
+        d = _mm_loadu_si128((const __m128i *)&dst[i]);
+
+        lo = over2_sse2(_mm_unpacklo_epi8(s, zero),
+                        _mm_unpacklo_epi8(d, zero), op);
+        hi = over2_sse2(_mm_unpackhi_epi8(s, zero),
+                        _mm_unpackhi_epi8(d, zero), op);
+
+        _mm_storeu_si128((__m128i *)&dst[i],
+                         _mm_or_si128(_mm_packus_epi16(lo, hi), opaque));
+    }
+
+    over_c(dst + i, src + i, n - i, opacity);
+}
+
+/* (a * (256 - f) + b * f) >> 8 on 16-bit lanes, as bilerp_c */
+
+__attribute__((target("sse2")))
+static __m128i lerp256_sse2(__m128i a, __m128i b, __m128i f)
+{
+    return _mm_srli_epi16(_mm_add_epi16(
+        _mm_mullo_epi16(a, _mm_sub_epi16(_mm_set1_epi16(256), f)),
+        _mm_mullo_epi16(b, f)), 8);
+}
+
+/* 4 weights in 32-bit lanes to 16 bits, each copied 4 times */
+
+__attribute__((target("sse2")))
+static void weights_sse2(__m128i f, __m128i *lo, __m128i *hi)
+{
+    f = _mm_packs_epi32(f, f);
+    f = _mm_unpacklo_epi16(f, f);
+    *lo = _mm_unpacklo_epi32(f, f);
+    *hi = _mm_unpackhi_epi32(f, f);
+}
+
+/*
+ * Four samples at a time. Coordinates and weights are worked
+ * out for all four at once. Each sample then takes its two
+ * texel pairs in two loads and blends them vertically, and
+ * the horizontal blends run two samples to a register. A
+ * group wholly off the image is transparent. Any other group
+ * with a sample on the last row or column, or off the image,
+ * is left to sample_c, which handles edges.
+ */
+
+__attribute__((target("sse2")))
+static void sample_sse2(uint32_t *dst,
+                        const uint32_t *src, int w, int h,
+                        int32_t u, int32_t v,
+                        int32_t du, int32_t dv,
+                        int n)
+{
+    __m128i steps_u, steps_v;
+    __m128i xmax, ymax, m8, zero;
+    int i;
+
+    /* with fewer than 4, 3 * du could be off the image */
+    if (n < 4) {
+        sample_c(dst, src, w, h, u, v, du, dv, n);
+        return;
+    }
+
+    steps_u = _mm_set_epi32(3 * du, 2 * du, du, 0);
+    steps_v = _mm_set_epi32(3 * dv, 2 * dv, dv, 0);
+    xmax = _mm_set1_epi32(w - 1);
+    ymax = _mm_set1_epi32(h - 1);
+    m8 = _mm_set1_epi32(0xff);
+    zero = _mm_setzero_si128();
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128i vu, vv, x, y, in;
+        __m128i col[4], lo, hi;
+        __m128i fxlo, fxhi, fy, wy[4];
+        int32_t xs[4], ys[4];
+        int k;
+
+        vu = _mm_add_epi32(_mm_set1_epi32(u + i * du), steps_u);
+        vv = _mm_add_epi32(_mm_set1_epi32(v + i * dv), steps_v);
+        x = _mm_srai_epi32(vu, 16);
+        y = _mm_srai_epi32(vv, 16);
+
+        /* 0 <= x < w - 1 and 0 <= y < h - 1 in every lane */
+        in = _mm_and_si128(_mm_cmpgt_epi32(x, _mm_set1_epi32(-1)),
+                           _mm_cmpgt_epi32(xmax, x));
+        in = _mm_and_si128(in, _mm_cmpgt_epi32(y, _mm_set1_epi32(-1)));
+        in = _mm_and_si128(in, _mm_cmpgt_epi32(ymax, y));
+
+        if (_mm_movemask_epi8(in) != 0xffff) {
+            __m128i out;
+
+            /* x < -1 or x >= w or y < -1 or y >= h in every lane */
+            out = _mm_or_si128(_mm_cmpgt_epi32(_mm_set1_epi32(-1), x),
+                               _mm_cmpgt_epi32(x, xmax));
+            out = _mm_or_si128(out, _mm_cmpgt_epi32(_mm_set1_epi32(-1), y));
+            out = _mm_or_si128(out, _mm_cmpgt_epi32(y, ymax));
+
+            if (_mm_movemask_epi8(out) == 0xffff) {
+                _mm_storeu_si128((__m128i *)&dst[i], zero);
+            } else {
+                sample_c(dst + i, src, w, h, u + i * du, v + i * dv,
+                         du, dv, 4);
+            }
+            continue;
+        }
+
+        _mm_storeu_si128((__m128i *)xs, x);
+        _mm_storeu_si128((__m128i *)ys, y);
+
+        /* fy of sample k in all 8 lanes of wy[k] */
+        fy = _mm_and_si128(_mm_srli_epi32(vv, 8), m8);
+        fy = _mm_packs_epi32(fy, fy);
+        fy = _mm_unpacklo_epi16(fy, fy);
+        wy[0] = _mm_shuffle_epi32(fy, 0x00);
+        wy[1] = _mm_shuffle_epi32(fy, 0x55);
+        wy[2] = _mm_shuffle_epi32(fy, 0xaa);
+        wy[3] = _mm_shuffle_epi32(fy, 0xff);
+
+        /* the left and right columns of each sample, 4 channels each */
+        for (k = 0; k < 4; k++) {
+            const uint32_t *p;
+            __m128i top, bot;
+
+            p = &src[ys[k] * w + xs[k]];
+            top = _mm_loadl_epi64((const __m128i *)p);
+            bot = _mm_loadl_epi64((const __m128i *)(p + w));
+            col[k] = lerp256_sse2(_mm_unpacklo_epi8(top, zero),
+                                  _mm_unpacklo_epi8(bot, zero),
+                                  wy[k]);
+        }
+
+        weights_sse2(_mm_and_si128(_mm_srli_epi32(vu, 8), m8), &fxlo, &fxhi);
+
+        lo = lerp256_sse2(_mm_unpacklo_epi64(col[0], col[1]),
+                          _mm_unpackhi_epi64(col[0], col[1]),
+                          fxlo);
+        hi = lerp256_sse2(_mm_unpacklo_epi64(col[2], col[3]),
+                          _mm_unpackhi_epi64(col[2], col[3]),
+                          fxhi);
+
+        _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(lo, hi));
+    }
+
+    if (i < n) {
+        sample_c(dst + i, src, w, h, u + i * du, v + i * dv, du, dv, n - i);
+    }
+}
+
+#endif
+
+static void (*over)(uint32_t *, const uint32_t *, int, int) = NULL;
+
+static void (*sample)(uint32_t *,
+                      const uint32_t *, int, int,
+                      int32_t, int32_t,
+                      int32_t, int32_t,
+                      int) = NULL;
+
+/* picks the blit kernels for this CPU, once */
+
+void sg_blit_init(void)
+{
+    if (over != NULL) return;
+
+    over = over_c;
+    sample = sample_c;
+
+#ifdef SG_BLIT_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2")) {
+        over = over_sse2;
+        sample = sample_sse2;
+    }
+#endif
+}
+
+/*
+ * Bilinear samples of a premultiplied w by h image along a
+ * line: n of them, from u, v stepping by du, dv. These are
+ * 16.16 fixed point texel coordinates with texel centers on
+ * the integers. Texels off the image are transparent, so
+ * edges fade out over one texel. The first and last samples
+ * must be within 32767 texels of the image, so no step in
+ * between overflows.
+ */
+
+void sg_blit_sample(uint32_t *dst,
+                    const uint32_t *src, int w, int h,
+                    int32_t u, int32_t v,
+                    int32_t du, int32_t dv,
+                    int n)
+{
+    sg_blit_init();
+    sample(dst, src, w, h, u, v, du, dv, n);
+}
+
+/*
+ * Halves a premultiplied image with a box filter, for the
+ * mipmaps. Odd edges repeat their last texel.
+ */
+
+void sg_blit_halve(const uint32_t *src, int w, int h, uint32_t *dst)
+{
+    int dw, dh;
+    int x, y;
+
+    dw = w > 1 ? w / 2 : 1;
+    dh = h > 1 ? h / 2 : 1;
+
+    for (y = 0; y < dh; y++) {
+        const uint32_t *r0, *r1;
+
+        r0 = &src[(2 * y < h ? 2 * y : h - 1) * w];
+        r1 = &src[(2 * y + 1 < h ? 2 * y + 1 : h - 1) * w];
+
+        for (x = 0; x < dw; x++) {
+            int x0, x1;
+            uint32_t out;
+            int sh;
+
+            x0 = 2 * x < w ? 2 * x : w - 1;
+            x1 = 2 * x + 1 < w ? 2 * x + 1 : w - 1;
+            out = 0;
+
+            for (sh = 0; sh < 32; sh += 8) {
+                uint32_t sum;
+                sum = ((r0[x0] >> sh) & 0xff) + ((r0[x1] >> sh) & 0xff) +
+                    ((r1[x0] >> sh) & 0xff) + ((r1[x1] >> sh) & 0xff);
+                out |= ((sum + 2) >> 2) << sh;
+            }
+
+            dst[y * dw + x] = out;
+        }
+    }
+}
+
+/*
+ * Composites n premultiplied pixels over dst, scaled by
+ * opacity, 0 to 255.
+ */
+
+void sg_blit_over(uint32_t *dst, const uint32_t *src, int n, int opacity)
+{
+    if (opacity <= 0) return;
+    if (opacity > 255) opacity = 255;
+
+    sg_blit_init();
+    over(dst, src, n, opacity);
+}
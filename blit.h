@@ -0,0 +1,13 @@
+#ifndef SG_BLIT_H
+#define SG_BLIT_H
+void sg_blit_init(void);
+void sg_blit_premultiply(const uint8_t *rgba, uint32_t *dst, int n);
+int sg_blit_runs(const uint32_t *pm, int n, int *runs);
+void sg_blit_over(uint32_t *dst, const uint32_t *src, int n, int opacity);
+void sg_blit_sample(uint32_t *dst,
+                    const uint32_t *src, int w, int h,
+                    int32_t u, int32_t v,
+                    int32_t du, int32_t dv,
+                    int n);
+void sg_blit_halve(const uint32_t *src, int w, int h, uint32_t *dst);
+#endif
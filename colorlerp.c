@@ -7,10 +7,17 @@
 #include <stdlib.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "colorlerp.h"
 
 #include "gammatables.h"
+#include "lintables.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SG_COLORLERP_X86
+#include <immintrin.h>
+#endif
 
 #define FAST_GAMMA
 
@@ -93,6 +100,41 @@ void sg_gammatables(int sz)
     fprintf(fp, "};");
 }
 
+/*
+ * used to generate the span lookup tables: exact sRGB
+ * decoding of 8-bit values, and 8-bit encoding of linear
+ * values quantized to LINTABLE_SIZE steps
+ */
+
+void sg_lintables(void)
+{
+    FILE *fp;
+    int i;
+    fp = stdout;
+
+    fprintf(fp, "#define LINTABLE_SIZE %d\n", 4096);
+    fprintf(fp, "static const float srgb2lin[] = {");
+    for (i = 0; i < 256; i++) {
+        double u, y;
+        u = i / 255.0;
+        if (u <= 0.04045) y = u / 12.92;
+        else y = pow((u + 0.055)/1.055, 2.4);
+        fprintf(fp, "%.9g,%s", y, (i % 6) == 5 ? "\n" : " ");
+    }
+    fprintf(fp, "};\n");
+
+    fprintf(fp, "static const uint8_t lin2srgb[] = {");
+    for (i = 0; i < 4096; i++) {
+        double u, y;
+        u = i / 4095.0;
+        if (u <= 0.0031308) y = u * 12.92;
+        else y = pow(u, 1.0/2.4) * 1.055 - 0.055;
+        fprintf(fp, "%d,%s", (int)floor(y * 255 + 0.5),
+                (i % 12) == 11 ? "\n" : " ");
+    }
+    fprintf(fp, "};\n");
+}
+
 void sg_colorlerp(uint8_t c0_r, uint8_t c0_g, uint8_t c0_b,
                   uint8_t c1_r, uint8_t c1_g, uint8_t c1_b,
                   float a,
@@ -153,3 +195,719 @@ void sg_colorlerp_lin(uint8_t c0_r, uint8_t c0_g, uint8_t c0_b,
     *out_g = floor((1 - a) * c0_g + a * c1_g);
     *out_b = floor((1 - a) * c0_b + a * c1_b);
 }
+
+/*
+ * blends clr (already linear) over one xRGB pixel. a is
+ * clamped to [0, 1] so the result stays inside lin2srgb.
+ */
+
+static uint32_t blend(uint32_t p, const float *clr, float a)
+{
+    float r, g, b;
+
+    if (a <= 0) return p;
+    if (a > 1) a = 1;
+
+    r = srgb2lin[(p >> 16) & 0xff];
+    g = srgb2lin[(p >> 8) & 0xff];
+    b = srgb2lin[p & 0xff];
+
+    r = (1 - a) * r + a * clr[0];
+    g = (1 - a) * g + a * clr[1];
+    b = (1 - a) * b + a * clr[2];
+
+    return 0xff000000 |
+        (uint32_t)lin2srgb[(int)(r * (LINTABLE_SIZE - 1) + 0.5f)] << 16 |
+        (uint32_t)lin2srgb[(int)(g * (LINTABLE_SIZE - 1) + 0.5f)] << 8 |
+        (uint32_t)lin2srgb[(int)(b * (LINTABLE_SIZE - 1) + 0.5f)];
+}
+
+static void linclr(uint32_t clr, float *lin)
+{
+    lin[0] = srgb2lin[(clr >> 16) & 0xff];
+    lin[1] = srgb2lin[(clr >> 8) & 0xff];
+    lin[2] = srgb2lin[clr & 0xff];
+}
+
+/* blends with per-pixel amounts, or a for every pixel */
+
+static void span_c(uint32_t *dst, int n,
+                   uint32_t clr, const float *lin,
+                   const float *alpha, float a)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        float ai;
+
+        ai = alpha == NULL ? a : alpha[i];
+
+        if (ai >= 1) dst[i] = clr;
+        else dst[i] = blend(dst[i], lin, ai);
+    }
+}
+
+#ifdef SG_COLORLERP_X86
+/*
+ * The SIMD blend does 8 pixels per step with no table
+ * lookups. It needs AVX2 and FMA: without fused Horner
+ * steps the polynomials cost more than the lookups they
+ * replace, and the table blend stays faster.
+ *
+ * Above the linear toe, sRGB decoding is a degree 6
+ * polynomial in the 8-bit value. Encoding is a degree 6
+ * polynomial in x^(1/4), where the curve is smooth enough to
+ * fit. Both are Chebyshev fits, off by at most 9e-6 and
+ * 2e-6. That is closer than the LINTABLE_SIZE steps of
+ * lin2srgb, so a channel can come out 1 away from the table
+ * blend, never more.
+ */
+
+#define DEC0 0.000931145449f
+#define DEC1 0.0326325297f
+#define DEC2 0.515857697f
+#define DEC3 0.700870752f
+#define DEC4 -0.406270951f
+#define DEC5 0.203136593f
+#define DEC6 -0.0471605808f
+
+#define ENC0 -0.0597390123f
+#define ENC1 0.141958266f
+#define ENC2 1.35457265f
+#define ENC3 -0.825280011f
+#define ENC4 0.621002257f
+#define ENC5 -0.294247627f
+#define ENC6 0.0617343076f
+
+#define HORNER_AVX2(p, x, c) \
+    _mm256_fmadd_ps(p, x, _mm256_set1_ps(c))
+
+/* 8-bit channel values in 32-bit lanes to linear */
+
+__attribute__((target("avx2,fma")))
+static __m256 decode_avx2(__m256i c)
+{
+    __m256 u, p, toe;
+
+    u = _mm256_mul_ps(_mm256_cvtepi32_ps(c), _mm256_set1_ps(1.f / 255));
+
+    p = _mm256_set1_ps(DEC6);
+    p = HORNER_AVX2(p, u, DEC5);
+    p = HORNER_AVX2(p, u, DEC4);
+    p = HORNER_AVX2(p, u, DEC3);
+    p = HORNER_AVX2(p, u, DEC2);
+    p = HORNER_AVX2(p, u, DEC1);
+    p = HORNER_AVX2(p, u, DEC0);
+
+    toe = _mm256_cmp_ps(u, _mm256_set1_ps(0.04045f), _CMP_LE_OQ);
+    return _mm256_blendv_ps(p,
+                            _mm256_mul_ps(u, _mm256_set1_ps(1 / 12.92f)),
+                            toe);
+}
+
+/* linear in [0, 1] to 8-bit channel values in 32-bit lanes */
+
+__attribute__((target("avx2,fma")))
+static __m256i encode_avx2(__m256 x)
+{
+    __m256 t, p, toe, y;
+
+    t = _mm256_sqrt_ps(_mm256_sqrt_ps(x));
+
+    p = _mm256_set1_ps(ENC6);
+    p = HORNER_AVX2(p, t, ENC5);
+    p = HORNER_AVX2(p, t, ENC4);
+    p = HORNER_AVX2(p, t, ENC3);
+    p = HORNER_AVX2(p, t, ENC2);
+    p = HORNER_AVX2(p, t, ENC1);
+    p = HORNER_AVX2(p, t, ENC0);
+
+    toe = _mm256_cmp_ps(x, _mm256_set1_ps(0.0031308f), _CMP_LE_OQ);
+    y = _mm256_blendv_ps(p, _mm256_mul_ps(x, _mm256_set1_ps(12.92f)), toe);
+
+    return _mm256_cvttps_epi32(_mm256_fmadd_ps(y, _mm256_set1_ps(255),
+                                               _mm256_set1_ps(0.5f)));
+}
+
+/* (1 - a) * dst + a * lin, per channel, as blend() */
+
+__attribute__((target("avx2,fma")))
+static __m256i mix_avx2(__m256i px, __m256 a, const float *lin)
+{
+    __m256i m, r, g, b;
+    __m256 ia;
+
+    m = _mm256_set1_epi32(0xff);
+    ia = _mm256_sub_ps(_mm256_set1_ps(1), a);
+
+    r = _mm256_and_si256(_mm256_srli_epi32(px, 16), m);
+    g = _mm256_and_si256(_mm256_srli_epi32(px, 8), m);
+    b = _mm256_and_si256(px, m);
+
+    r = encode_avx2(_mm256_fmadd_ps(ia, decode_avx2(r),
+                    _mm256_mul_ps(a, _mm256_set1_ps(lin[0]))));
+    g = encode_avx2(_mm256_fmadd_ps(ia, decode_avx2(g),
+                    _mm256_mul_ps(a, _mm256_set1_ps(lin[1]))));
+    b = encode_avx2(_mm256_fmadd_ps(ia, decode_avx2(b),
+                    _mm256_mul_ps(a, _mm256_set1_ps(lin[2]))));
+
+    return _mm256_or_si256(_mm256_or_si256(_mm256_set1_epi32(0xff000000),
+                                           _mm256_slli_epi32(r, 16)),
+                           _mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+}
+
+__attribute__((target("avx2,fma")))
+static void span_avx2(uint32_t *dst, int n,
+                      uint32_t clr, const float *lin,
+                      const float *alpha, float a)
+{
+    __m256 va, zero, one;
+    int i;
+
+    zero = _mm256_setzero_ps();
+    one = _mm256_set1_ps(1);
+    va = _mm256_set1_ps(a);
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256i px, out;
+        __m256 keep, full;
+
+        if (alpha != NULL) va = _mm256_loadu_ps(&alpha[i]);
+
+        keep = _mm256_cmp_ps(va, zero, _CMP_LE_OQ);
+        if (_mm256_movemask_ps(keep) == 0xff) continue;
+        full = _mm256_cmp_ps(va, one, _CMP_GE_OQ);
+
+        if (_mm256_movemask_ps(full) == 0xff) {
+            _mm256_storeu_si256((__m256i *)&dst[i], _mm256_set1_epi32(clr));
+            continue;
+        }
+
+        px = _mm256_loadu_si256((const __m256i *)&dst[i]);
+        out = mix_avx2(px, _mm256_min_ps(_mm256_max_ps(va, zero), one), lin);
+
+        out = _mm256_blendv_epi8(out, _mm256_set1_epi32(clr),
+                                 _mm256_castps_si256(full));
+        out = _mm256_blendv_epi8(out, px, _mm256_castps_si256(keep));
+
+        _mm256_storeu_si256((__m256i *)&dst[i], out);
+    }
+
+    span_c(dst + i, n - i, clr, lin, alpha == NULL ? NULL : alpha + i, a);
+}
+#endif
+
+/*
+ * (1 - a) * dst + a * src on the raw 8-bit channels, as
+ * sg_colorlerp_lin, for a row of xRGB pixels.
+ */
+
+static void lerp_c(uint32_t *dst, const uint32_t *src, int n, float a)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint8_t rgb[3];
+
+        sg_colorlerp_lin((dst[i] >> 16) & 0xff,
+                         (dst[i] >> 8) & 0xff,
+                         dst[i] & 0xff,
+                         (src[i] >> 16) & 0xff,
+                         (src[i] >> 8) & 0xff,
+                         src[i] & 0xff,
+                         a,
+                         &rgb[0], &rgb[1], &rgb[2]);
+
+        dst[i] = 0xff000000 | rgb[0] << 16 | rgb[1] << 8 | rgb[2];
+    }
+}
+
+#ifdef SG_COLORLERP_X86
+/*
+ * The same float arithmetic as lerp_c, four channels to a
+ * register. The sums are never negative, so truncating is
+ * the floor.
+ */
+
+__attribute__((target("sse2")))
+static __m128 lerp4_sse2(__m128i d, __m128i s, __m128 a, __m128 ia)
+{
+    return _mm_add_ps(_mm_mul_ps(ia, _mm_cvtepi32_ps(d)),
+                      _mm_mul_ps(a, _mm_cvtepi32_ps(s)));
+}
+
+__attribute__((target("sse2")))
+static void lerp_sse2(uint32_t *dst, const uint32_t *src, int n, float a)
+{
+    __m128i zero;
+    __m128 va, ia;
+    int i;
+
+    zero = _mm_setzero_si128();
+    va = _mm_set1_ps(a);
+    ia = _mm_set1_ps(1 - a);
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128i d, s, dlo, dhi, slo, shi, lo, hi;
+
+        d = _mm_loadu_si128((const __m128i *)&dst[i]);
+        s = _mm_loadu_si128((const __m128i *)&src[i]);
+
+        dlo = _mm_unpacklo_epi8(d, zero);
+        dhi = _mm_unpackhi_epi8(d, zero);
+        slo = _mm_unpacklo_epi8(s, zero);
+        shi = _mm_unpackhi_epi8(s, zero);
+
+        lo = _mm_packs_epi32(
+            _mm_cvttps_epi32(lerp4_sse2(_mm_unpacklo_epi16(dlo, zero),
+                                        _mm_unpacklo_epi16(slo, zero),
+                                        va, ia)),
+            _mm_cvttps_epi32(lerp4_sse2(_mm_unpackhi_epi16(dlo, zero),
+                                        _mm_unpackhi_epi16(slo, zero),
+                                        va, ia)));
+        hi = _mm_packs_epi32(
+            _mm_cvttps_epi32(lerp4_sse2(_mm_unpacklo_epi16(dhi, zero),
+                                        _mm_unpacklo_epi16(shi, zero),
+                                        va, ia)),
+            _mm_cvttps_epi32(lerp4_sse2(_mm_unpackhi_epi16(dhi, zero),
+                                        _mm_unpackhi_epi16(shi, zero),
+                                        va, ia)));
+
+        _mm_storeu_si128((__m128i *)&dst[i],
+                         _mm_or_si128(_mm_packus_epi16(lo, hi),
+                                      _mm_set1_epi32(0xff000000)));
+    }
+
+    lerp_c(dst + i, src + i, n - i, a);
+}
+#endif
+
+static void (*lerp)(uint32_t *, const uint32_t *, int, float) = NULL;
+
+static void (*span)(uint32_t *, int,
+                    uint32_t, const float *,
+                    const float *, float) = NULL;
+
+/* picks the fastest kernels the CPU supports */
+
+void sg_colorlerp_init(void)
+{
+    if (span != NULL) return;
+
+    span = span_c;
+    lerp = lerp_c;
+
+#ifdef SG_COLORLERP_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2")) {
+        lerp = lerp_sse2;
+    }
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        span = span_avx2;
+    }
+#endif
+}
+
+/*
+ * sRGB-correct blend of clr over a row of n xRGB pixels,
+ * like sg_colorlerp. alpha holds per-pixel amounts, or is
+ * NULL to use a for every pixel. Amounts are clamped to
+ * [0, 1].
+ */
+
+void sg_colorlerp_span(uint32_t *dst, int n,
+                       uint32_t clr,
+                       const float *alpha,
+                       float a)
+{
+    float lin[3];
+    int i;
+
+    sg_colorlerp_init();
+
+    clr |= 0xff000000;
+
+    if (alpha == NULL) {
+        if (a <= 0) return;
+        if (a >= 1) {
+            for (i = 0; i < n; i++) dst[i] = clr;
+            return;
+        }
+    }
+
+    linclr(clr, lin);
+    span(dst, n, clr, lin, alpha, a);
+}
+
+/*
+ * Mixes a row of n xRGB pixels src into dst by a, on the
+ * stored channel values like sg_colorlerp_lin.
+ */
+
+void sg_colorlerp_mix(uint32_t *dst, const uint32_t *src, int n, float a)
+{
+    sg_colorlerp_init();
+    lerp(dst, src, n, a);
+}
+
+/*
+ * Coverage to amounts a chunk at a time, for the span
+ * kernel. Full coverage at full a is exactly 1.
+ */
+
+#define COV_CHUNK 256
+
+static void span8(uint32_t *dst, int n,
+                  uint32_t clr, const float *lin,
+                  const uint8_t *cov, int step,
+                  float a)
+{
+    float amt[COV_CHUNK];
+    float scale;
+    int i, j, m;
+
+    scale = a / 255.f;
+
+    for (i = 0; i < n; i += m) {
+        m = n - i;
+        if (m > COV_CHUNK) m = COV_CHUNK;
+
+        for (j = 0; j < m; j++) amt[j] = cov[(i + j) * step] * scale;
+
+        span(dst + i, m, clr, lin, amt, 0);
+    }
+}
+
+/*
+ * Same, with 8-bit coverage scaled by a as the amount.
+ * Coverage is read every step bytes, so the red channel of
+ * an RGBA image works as well as an alpha-only mask.
+ */
+
+void sg_colorlerp_span8(uint32_t *dst, int n,
+                        uint32_t clr,
+                        const uint8_t *cov, int step,
+                        float a)
+{
+    float lin[3];
+
+    if (a <= 0) return;
+
+    sg_colorlerp_init();
+
+    clr |= 0xff000000;
+    linclr(clr, lin);
+    span8(dst, n, clr, lin, cov, step, a);
+}
+
+/*
+ * Skips the zero coverage at the start of a row of n, four
+ * bytes at a time. Returns the first nonzero index, or n.
+ */
+
+static int skip_empty(const uint8_t *cov, int x, int n)
+{
+    uint32_t quad;
+
+    while (x + 4 <= n) {
+        memcpy(&quad, &cov[x], 4);
+        if (quad != 0) break;
+        x += 4;
+    }
+
+    while (x < n && cov[x] == 0) x++;
+
+    return x;
+}
+
+/*
+ * Glyph compositor: blends clr over a w by h block of dst
+ * through a block of 8-bit coverage (a fontstash atlas), by
+ * coverage times a. Same result as sg_colorlerp_span8 on
+ * every row, with the color decoded once and the empty
+ * coverage at either end of a row skipped.
+ */
+
+void sg_colorlerp_glyph(uint32_t *dst, int dstride,
+                        const uint8_t *cov, int cstride,
+                        int w, int h,
+                        uint32_t clr,
+                        float a)
+{
+    float lin[3];
+    int y;
+
+    if (a <= 0) return;
+
+    sg_colorlerp_init();
+
+    clr |= 0xff000000;
+    linclr(clr, lin);
+
+    for (y = 0; y < h; y++) {
+        const uint8_t *c;
+        int x0, x1;
+
+        c = &cov[y * cstride];
+
+        /* the span kernel skips empty stretches inside the row */
+        x0 = skip_empty(c, 0, w);
+        x1 = w;
+        while (x1 > x0 && c[x1 - 1] == 0) x1--;
+
+        if (x0 < x1) {
+            span8(&dst[y * dstride + x0], x1 - x0, clr, lin, c + x0, 1, a);
+        }
+    }
+}
+
+/*
+ * 16-bit linear light. Pixels are premultiplied RGBA, four
+ * uint16_t each, with 65535 as 1. The frame is opaque, so
+ * "over" with a solid color is the same lerp on all four
+ * channels, and needs no tables once the color is decoded.
+ */
+
+static uint16_t lin16(int c)
+{
+    return srgb2lin[c] * 65535 + 0.5f;
+}
+
+static uint8_t srgb8(uint16_t c)
+{
+    return lin2srgb[((uint32_t)c * (LINTABLE_SIZE - 1) + 32768) >> 16];
+}
+
+/* xRGB pixels to linear */
+
+void sg_lin_decode(const uint32_t *src, uint16_t *dst, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        dst[4*i + 0] = lin16((src[i] >> 16) & 0xff);
+        dst[4*i + 1] = lin16((src[i] >> 8) & 0xff);
+        dst[4*i + 2] = lin16(src[i] & 0xff);
+        dst[4*i + 3] = 65535;
+    }
+}
+
+/* RGBA bytes, as loaded by lodepng, to linear; alpha is ignored */
+
+void sg_lin_decode_rgba(const uint8_t *src, uint16_t *dst, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        dst[4*i + 0] = lin16(src[4*i + 0]);
+        dst[4*i + 1] = lin16(src[4*i + 1]);
+        dst[4*i + 2] = lin16(src[4*i + 2]);
+        dst[4*i + 3] = 65535;
+    }
+}
+
+/* linear back to xRGB pixels */
+
+void sg_lin_encode(const uint16_t *src, uint32_t *dst, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        dst[i] = 0xff000000 |
+            (uint32_t)srgb8(src[4*i + 0]) << 16 |
+            (uint32_t)srgb8(src[4*i + 1]) << 8 |
+            (uint32_t)srgb8(src[4*i + 2]);
+    }
+}
+
+/* d + (s - d) * a, with a in [0, 65536] */
+
+static uint16_t mix16(uint32_t d, uint32_t s, uint32_t a)
+{
+    return (s * a + d * (65536 - a) + 32768) >> 16;
+}
+
+static uint32_t amount16(float a)
+{
+    if (a <= 0) return 0;
+    if (a >= 1) return 65536;
+    return a * 65536 + 0.5f;
+}
+
+static void lin16clr(uint32_t clr, uint16_t *c)
+{
+    c[0] = lin16((clr >> 16) & 0xff);
+    c[1] = lin16((clr >> 8) & 0xff);
+    c[2] = lin16(clr & 0xff);
+    c[3] = 65535;
+}
+
+/* sg_colorlerp_span for linear pixels */
+
+void sg_lin_span(uint16_t *dst, int n,
+                 uint32_t clr,
+                 const float *alpha,
+                 float a)
+{
+    uint16_t c[4];
+    uint32_t k;
+    int i, j;
+
+    lin16clr(clr, c);
+    k = amount16(a);
+
+    for (i = 0; i < n; i++) {
+        if (alpha != NULL) k = amount16(alpha[i]);
+        for (j = 0; j < 4; j++) {
+            dst[4*i + j] = mix16(dst[4*i + j], c[j], k);
+        }
+    }
+}
+
+/* sg_colorlerp_span8 for linear pixels */
+
+void sg_lin_span8(uint16_t *dst, int n,
+                  uint32_t clr,
+                  const uint8_t *cov, int step,
+                  float a)
+{
+    uint16_t c[4];
+    uint32_t a16;
+    int i, j;
+
+    lin16clr(clr, c);
+    a16 = amount16(a);
+
+    for (i = 0; i < n; i++) {
+        uint32_t k;
+        uint32_t cv;
+
+        /* cov * 257 is coverage in 16 bits, so 255 gives all of a */
+        cv = cov[i * step];
+        if (cv == 255) k = a16;
+        else k = (cv * 257 * a16 + 32768) >> 16;
+        for (j = 0; j < 4; j++) {
+            dst[4*i + j] = mix16(dst[4*i + j], c[j], k);
+        }
+    }
+}
+
+/* sg_colorlerp_glyph for linear pixels */
+
+void sg_lin_glyph(uint16_t *dst, int dstride,
+                  const uint8_t *cov, int cstride,
+                  int w, int h,
+                  uint32_t clr,
+                  float a)
+{
+    uint16_t c[4];
+    uint32_t a16;
+    int x, y, j;
+
+    lin16clr(clr, c);
+    a16 = amount16(a);
+    if (a16 == 0) return;
+
+    for (y = 0; y < h; y++) {
+        uint16_t *d;
+        const uint8_t *cv;
+
+        d = &dst[y * dstride * 4];
+        cv = &cov[y * cstride];
+
+        for (x = skip_empty(cv, 0, w); x < w; x = skip_empty(cv, x + 1, w)) {
+            uint32_t k;
+
+            if (cv[x] == 255) k = a16;
+            else k = (cv[x] * 257 * a16 + 32768) >> 16;
+            for (j = 0; j < 4; j++) {
+                d[4*x + j] = mix16(d[4*x + j], c[j], k);
+            }
+        }
+    }
+}
+
+/* lerps a row of linear pixels towards src by a */
+
+void sg_lin_mix(uint16_t *dst, const uint16_t *src, int n, float a)
+{
+    uint32_t k;
+    int i;
+
+    k = amount16(a);
+
+    for (i = 0; i < 4 * n; i++) {
+        dst[i] = mix16(dst[i], src[i], k);
+    }
+}
+
+/*
+ * Straight RGBA pixels over linear ones, each by its own
+ * alpha scaled by a.
+ */
+
+void sg_lin_over(uint16_t *dst, const uint8_t *rgba, int n, float a)
+{
+    uint32_t a16;
+    int i, j;
+
+    a16 = amount16(a);
+
+    for (i = 0; i < n; i++) {
+        uint32_t k;
+        uint32_t cv;
+        uint16_t c[4];
+
+        cv = rgba[4*i + 3];
+        if (cv == 0) continue;
+        if (cv == 255) k = a16;
+        else k = (cv * 257 * a16 + 32768) >> 16;
+
+        c[0] = lin16(rgba[4*i]);
+        c[1] = lin16(rgba[4*i + 1]);
+        c[2] = lin16(rgba[4*i + 2]);
+        c[3] = 65535;
+
+        for (j = 0; j < 4; j++) {
+            dst[4*i + j] = mix16(dst[4*i + j], c[j], k);
+        }
+    }
+}
+
+/*
+ * Premultiplied ARGB32 pixels over linear ones, scaled by a.
+ */
+
+void sg_lin_over_pm(uint16_t *dst, const uint32_t *pm, int n, float a)
+{
+    uint32_t a16;
+    int i, j;
+
+    a16 = amount16(a);
+
+    for (i = 0; i < n; i++) {
+        uint32_t k;
+        uint32_t cv;
+        uint16_t c[4];
+
+        cv = pm[i] >> 24;
+        if (cv == 0) continue;
+        if (cv == 255) k = a16;
+        else k = (cv * 257 * a16 + 32768) >> 16;
+
+        for (j = 0; j < 3; j++) {
+            uint32_t s;
+            s = (pm[i] >> (16 - 8*j)) & 0xff;
+            if (cv < 255) s = (s * 255 + cv / 2) / cv;
+            if (s > 255) s = 255;
+            c[j] = lin16(s);
+        }
+        c[3] = 65535;
+
+        for (j = 0; j < 4; j++) {
+            dst[4*i + j] = mix16(dst[4*i + j], c[j], k);
+        }
+    }
+}
@@ -7,3 +7,49 @@ void sg_colorlerp_lin(uint8_t c0_r, uint8_t c0_g, uint8_t c0_b,
                       uint8_t c1_r, uint8_t c1_g, uint8_t c1_b,
                       float a,
                       uint8_t *out_r, uint8_t *out_g, uint8_t *out_b);
+
+void sg_colorlerp_init(void);
+
+void sg_colorlerp_span(uint32_t *dst, int n,
+                       uint32_t clr,
+                       const float *alpha,
+                       float a);
+
+void sg_colorlerp_mix(uint32_t *dst, const uint32_t *src, int n, float a);
+
+void sg_colorlerp_span8(uint32_t *dst, int n,
+                        uint32_t clr,
+                        const uint8_t *cov, int step,
+                        float a);
+
+void sg_lin_decode(const uint32_t *src, uint16_t *dst, int n);
+void sg_lin_decode_rgba(const uint8_t *src, uint16_t *dst, int n);
+void sg_lin_encode(const uint16_t *src, uint32_t *dst, int n);
+
+void sg_lin_span(uint16_t *dst, int n,
+                 uint32_t clr,
+                 const float *alpha,
+                 float a);
+
+void sg_lin_span8(uint16_t *dst, int n,
+                  uint32_t clr,
+                  const uint8_t *cov, int step,
+                  float a);
+
+void sg_lin_mix(uint16_t *dst, const uint16_t *src, int n, float a);
+
+void sg_colorlerp_glyph(uint32_t *dst, int dstride,
+                        const uint8_t *cov, int cstride,
+                        int w, int h,
+                        uint32_t clr,
+                        float a);
+
+void sg_lin_glyph(uint16_t *dst, int dstride,
+                  const uint8_t *cov, int cstride,
+                  int w, int h,
+                  uint32_t clr,
+                  float a);
+
+void sg_lin_over(uint16_t *dst, const uint8_t *rgba, int n, float a);
+
+void sg_lin_over_pm(uint16_t *dst, const uint32_t *pm, int n, float a);
@@ -0,0 +1,68 @@
+local vid = sgvideo
+
+-- encoder thread soak: the same frames encoded losslessly with
+-- one thread, x264's automatic threads, and sliced threads must
+-- decode to identical bytes. Needs ffmpeg on the path to decode.
+
+width = 320
+height = 240
+fps = 30
+nframes = 300
+rounds = 3
+
+function encode(filename, threads, sliced)
+    local v = vid.new()
+    vid.lossless(v, true)
+    vid.open(v, filename, width, height, fps, "i420", threads, sliced)
+
+    for n=1,nframes do
+        local t = n / fps
+        vid.fbmfill(v, 0x3b, 0x42, 0x52, 4, t)
+        vid.color(v, 1, 1, 1, 1)
+        vid.circ(v, width/2, height/2, 10 + 60*(1 + math.sin(t)) * 0.5)
+        vid.fill(v)
+        vid.append(v)
+    end
+
+    vid.close(v)
+    vid.del(v)
+end
+
+function decode(filename)
+    local raw = filename .. ".yuv"
+    assert(os.execute("ffmpeg -loglevel error -y -i " .. filename ..
+        " -f rawvideo -pix_fmt yuv420p " .. raw))
+    local fp = io.open(raw, "rb")
+    local data = fp:read("a")
+    fp:close()
+    os.remove(raw)
+    return data
+end
+
+local configs = {
+    {"single", 1, false},
+    {"auto", 0, false},
+    {"sliced", 0, true},
+}
+
+for r=1,rounds do
+    local ref = nil
+
+    for _, c in ipairs(configs) do
+        local filename = "encode_threads_" .. c[1] .. ".h264"
+        encode(filename, c[2], c[3])
+        local data = decode(filename)
+        os.remove(filename)
+
+        assert(#data == width * height * 3 / 2 * nframes,
+               c[1] .. ": decoded the wrong number of frames")
+
+        if ref == nil then
+            ref = data
+        else
+            assert(data == ref, c[1] .. ": decode differs from single thread")
+        end
+    end
+
+    print("round " .. r .. " ok")
+end
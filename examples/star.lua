@@ -38,7 +38,7 @@ dur = 5 -- seconds
 nframes = dur * fps
 
 v = vid.new()
-vid.open(v, "star.h264", width, height, 30)
+vid.open(v, "star.mp4", width, height, 30, "i420")
 setup_font(v)
 vid.unshade_init(v)
 
@@ -68,5 +68,3 @@ end
 
 vid.close(v)
 vid.del(v)
-
-os.execute("ffmpeg -y -i star.h264 -vf format=yuv420p star.mp4")
\ No newline at end of file
@@ -10,7 +10,7 @@ dur = 6 -- seconds
 nframes = dur * fps
 
 v = vid.new()
-vid.open(v, "test.h264", width, height, 30)
+vid.open(v, "test.mp4", width, height, 30, "i420")
 
 function setcolor(v, c)
     vid.color(v, c[1], c[2], c[3], 1)
@@ -28,5 +28,3 @@ end
 
 vid.close(v)
 vid.del(v)
-
-os.execute("ffmpeg -y -i test.h264 -vf format=yuv420p test.mp4")
\ No newline at end of file
@@ -0,0 +1,36 @@
+local vid = sgvideo
+
+-- a caption drifting by fractions of a pixel should be drawn
+-- from the text run cache, not rasterized every frame
+
+width = 320
+height = 240
+fps = 30
+dur = 4 -- seconds
+nframes = dur * fps
+
+v = vid.new()
+vid.open(v, "text_cache.mp4", width, height, 30, "i420")
+
+local font = vid.text_add_font(v, "bold", "font/Roboto-Bold.ttf")
+vid.text_setfont(v, font)
+vid.text_setsize(v, height * 0.1)
+vid.text_setcolor(v, vid.text_rgba(0xff, 0xff, 0xff, 0xff))
+vid.text_cache(v, 1024 * 1024)
+
+for n=1,nframes do
+    vid.color(v, 0x3b/255, 0x42/255, 0x52/255, 1)
+    vid.paint(v)
+    vid.text_draw(v, 20 + n * 0.37, height / 2 - n * 0.13, "Hello Muvik!")
+    vid.append(v)
+end
+
+local s = vid.text_cache_stats(v)
+print("hits", s.hits, "misses", s.misses, "bytes", s.bytes)
+
+-- one run per quarter-pixel step at most
+assert(s.misses <= 16, "translating caption missed the text cache")
+assert(s.hits + s.misses == nframes)
+
+vid.close(v)
+vid.del(v)
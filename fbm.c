@@ -7,6 +7,7 @@
 #include <stdio.h>
 
 float sg_simplex(float x, float y);
+void sg_simplex_n(const float *x, const float *y, float *out, int n);
 
 typedef struct {
     float x, y;
@@ -20,11 +21,6 @@ static vec2 mkvec2(float x, float y)
     return v;
 }
 
-static float dot(vec2 a, vec2 b)
-{
-    return a.x*b.x + a.y*b.y;
-}
-
 static vec2 muls(vec2 a, float s)
 {
     vec2 out;
@@ -41,16 +37,6 @@ static vec2 mul(vec2 a, vec2 b)
     return out;
 }
 
-static vec2 add(vec2 a, vec2 b)
-{
-    vec2 out;
-
-    out.x = a.x + b.x;
-    out.y = a.y + b.y;
-
-    return out;
-}
-
 static vec2 adds(vec2 a, float s)
 {
     vec2 out;
@@ -61,49 +47,20 @@ static vec2 adds(vec2 a, float s)
     return out;
 }
 
-static float fract(float x)
-{
-    return x - floorf(x);
-}
-
-static float mysin(vec2 st)
-{
-    return sinf(dot(st, mkvec2(12.9898,78.233)));
-}
-
-static float random(vec2 st)
-{
-    return sg_simplex(st.x, st.y);
-}
-
 static float mix(float x, float y, float a)
 {
     return x * (1 -a) + y * a;
 }
 
-static float noise(vec2 st)
-{
-    vec2 i;
-    vec2 f;
-
-    float a, b, c, d;
+/*
+ * Smoothstep blend of the lattice values a, b, c, d at the
+ * cell corners (0,0), (1,0), (0,1), (1,1), at offset f.
+ */
 
+static float blend(float a, float b, float c, float d, vec2 f)
+{
     vec2 u;
 
-    i.x = floorf(st.x);
-    i.y = floorf(st.y);
-
-    /* TODO: derive from i instead of fract */
-    /* f.x = fract(st.x); */
-    /* f.y = fract(st.y); */
-    f.x = st.x - i.x;
-    f.y = st.y - i.y;
-
-    a = random(i);
-    b = random(add(i, mkvec2(1.0, 0.0)));
-    c = random(add(i, mkvec2(0.0, 1.0)));
-    d = random(add(i, mkvec2(1.0, 1.0)));
-
     /* f * f * (3.0 - 2.0 * f) */
     /* f * f */
     u = mul(f, f);
@@ -114,22 +71,145 @@ static float noise(vec2 st)
             (d - b) * u.x * u.y;
 }
 
-float sg_fbm(float x, float y, int oct)
+#define FBM_BATCH 64
+
+/*
+ * Largest lattice grid, in points, that a batch will fill.
+ * Past this the corners are sampled point by point, which
+ * costs 4 per point anyway.
+ */
+
+#define FBM_GRID (4 * FBM_BATCH)
+
+/*
+ * Simplex values at the lattice corners (lx, ly), (lx+1, ly),
+ * (lx, ly+1), (lx+1, ly+1) of m points, into c[0..4m) in that
+ * order.
+ *
+ * Neighboring points share most of their corners, so when
+ * the cells they cover fit in a small grid the grid is
+ * sampled once and the corners are looked up from it. Either
+ * way the values are the same sg_simplex results.
+ */
+
+static void corners(const float *lx, const float *ly, int m, float *c)
 {
-    vec2 st;
-    float value;
-    float amplitude;
+    float gx[FBM_GRID];
+    float gy[FBM_GRID];
+    float gv[FBM_GRID];
+    float x0, y0, x1, y1;
+    int gw, gh;
     int i;
 
-    st = mkvec2(x, y);
-    value = 0;
-    amplitude = 0.5;
+    x0 = x1 = lx[0];
+    y0 = y1 = ly[0];
+
+    for (i = 1; i < m; i++) {
+        if (lx[i] < x0) x0 = lx[i];
+        if (lx[i] > x1) x1 = lx[i];
+        if (ly[i] < y0) y0 = ly[i];
+        if (ly[i] > y1) y1 = ly[i];
+    }
+
+    /* compared as floats so far-apart points can't overflow */
+    if ((x1 - x0 + 2) * (y1 - y0 + 2) <= FBM_GRID) {
+        int x, y;
+
+        gw = x1 - x0 + 2;
+        gh = y1 - y0 + 2;
+
+        for (y = 0; y < gh; y++) {
+            for (x = 0; x < gw; x++) {
+                gx[y * gw + x] = x0 + x;
+                gy[y * gw + x] = y0 + y;
+            }
+        }
+
+        sg_simplex_n(gx, gy, gv, gw * gh);
+
+        for (i = 0; i < m; i++) {
+            int pos;
 
-    for (i = 0; i < oct; i++) {
-        value += amplitude * noise(st);
-        st = muls(st, 2);
-        amplitude *= 0.6;
+            pos = (int)(ly[i] - y0) * gw + (int)(lx[i] - x0);
+
+            c[i] = gv[pos];
+            c[m + i] = gv[pos + 1];
+            c[2*m + i] = gv[pos + gw];
+            c[3*m + i] = gv[pos + gw + 1];
+        }
+
+        return;
     }
 
+    for (i = 0; i < m; i++) {
+        gx[i] = lx[i];
+        gy[i] = ly[i];
+        gx[m + i] = lx[i] + 1.0f;
+        gy[m + i] = ly[i];
+        gx[2*m + i] = lx[i];
+        gy[2*m + i] = ly[i] + 1.0f;
+        gx[3*m + i] = lx[i] + 1.0f;
+        gy[3*m + i] = ly[i] + 1.0f;
+    }
+
+    sg_simplex_n(gx, gy, c, 4 * m);
+}
+
+/*
+ * fbm at n points, in batches. Each octave gets the lattice
+ * corners of the whole batch at once, so each point is left
+ * with just the smoothstep blend.
+ */
+
+void sg_fbm_n(const float *x, const float *y, float *out, int n, int oct)
+{
+    float lx[FBM_BATCH];
+    float ly[FBM_BATCH];
+    float c[4 * FBM_BATCH];
+    vec2 st[FBM_BATCH];
+    int k, m, o;
+
+    for (k = 0; k < n; k += m) {
+        float amplitude;
+        int i;
+
+        m = n - k;
+        if (m > FBM_BATCH) m = FBM_BATCH;
+
+        for (i = 0; i < m; i++) {
+            st[i] = mkvec2(x[k + i], y[k + i]);
+            out[k + i] = 0;
+        }
+
+        amplitude = 0.5;
+
+        for (o = 0; o < oct; o++) {
+            for (i = 0; i < m; i++) {
+                lx[i] = floor(st[i].x);
+                ly[i] = floor(st[i].y);
+            }
+
+            corners(lx, ly, m, c);
+
+            for (i = 0; i < m; i++) {
+                vec2 f;
+
+                f.x = st[i].x - lx[i];
+                f.y = st[i].y - ly[i];
+
+                out[k + i] += amplitude *
+                    blend(c[i], c[m + i], c[2*m + i], c[3*m + i], f);
+                st[i] = muls(st[i], 2);
+            }
+
+            amplitude *= 0.6;
+        }
+    }
+}
+
+float sg_fbm(float x, float y, int oct)
+{
+    float value;
+    sg_fbm_n(&x, &y, &value, 1, oct);
     return value;
 }
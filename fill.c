@@ -15,16 +15,30 @@ struct fill_stuff {
     float alpha;
 };
 
-static void draw(vec3 *fragColor, vec2 fragCoord, us_image_data *id)
+static void draw(float *r, float *g, float *b,
+                 int n, vec2 pos, us_image_data *id)
 {
     struct fill_stuff *fs;
+    vec3 c;
+    float a;
+    int i;
 
     fs = id->ud;
-
-    if (fs->alpha >= 0) {
-        *fragColor = mix3(*fragColor, fs->color, fs->alpha);
+    c = fs->color;
+    a = fs->alpha;
+
+    if (a >= 0) {
+        for (i = 0; i < n; i++) {
+            r[i] = (1-a)*r[i] + a*c.x;
+            g[i] = (1-a)*g[i] + a*c.y;
+            b[i] = (1-a)*b[i] + a*c.z;
+        }
     } else {
-        *fragColor = fs->color;
+        for (i = 0; i < n; i++) {
+            r[i] = c.x;
+            g[i] = c.y;
+            b[i] = c.z;
+        }
     }
 }
 
@@ -32,20 +46,10 @@ void sg_video_unshade_fill(sg_video *v,
                            us_vec3 color,
                            float alpha)
 {
-    int w, h;
-    int fps;
-    int frame;
     struct fill_stuff fs;
-    vec3 *buf;
-
-    sg_video_dims(v, &w, &h);
-
-    buf = sg_video_unshadebuf(v);
 
     fs.color = color;
     fs.alpha = alpha;
 
-    fps = sg_video_fps(v);
-    frame = sg_video_framepos(v);
-    us_draw(buf, mkvec2(w, h), frame, fps, draw, &fs);
+    sg_video_unshade_span(v, draw, &fs);
 }
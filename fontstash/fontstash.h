@@ -105,6 +105,8 @@ FONS_DEF void fonsGetAtlasSize(FONScontext* s, int* width, int* height);
 FONS_DEF int fonsExpandAtlas(FONScontext* s, int width, int height);
 // Resets the whole stash.
 FONS_DEF int fonsResetAtlas(FONScontext* stash, int width, int height);
+// Glyph cache counters: lookups found, lookups missed, glyphs rasterized.
+FONS_DEF void fonsGetGlyphStats(FONScontext* s, int* hits, int* misses, int* rasters);
 
 // Add fonts
 FONS_DEF int fonsAddFont(FONScontext* s, const char* name, const char* path);
@@ -443,6 +445,7 @@ struct FONScontext
 	int nstates;
 	void (*handleError)(void* uptr, int error, int val);
 	void* errorUptr;
+	int nhits, nmisses, nrasters;
 };
 
 #ifdef STB_TRUETYPE_IMPLEMENTATION
@@ -1098,10 +1101,13 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	h = fons__hashint(codepoint) & (FONS_HASH_LUT_SIZE-1);
 	i = font->lut[h];
 	while (i != -1) {
-		if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur)
+		if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur) {
+			stash->nhits++;
 			return &font->glyphs[i];
+		}
 		i = font->glyphs[i].next;
 	}
+	stash->nmisses++;
 
 	// Could not find glyph, create it.
 	g = fons__tt_getGlyphIndex(&font->font, codepoint);
@@ -1153,6 +1159,7 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	font->lut[h] = font->nglyphs-1;
 
 	// Rasterize
+	stash->nrasters++;
 	dst = &stash->texData[(glyph->x0+pad) + (glyph->y0+pad) * stash->params.width];
 	fons__tt_renderGlyphBitmap(&renderFont->font, dst, gw-pad*2,gh-pad*2, stash->params.width, scale,scale, g);
 
@@ -1664,6 +1671,14 @@ FONS_DEF void fonsGetAtlasSize(FONScontext* stash, int* width, int* height)
 	*height = stash->params.height;
 }
 
+FONS_DEF void fonsGetGlyphStats(FONScontext* stash, int* hits, int* misses, int* rasters)
+{
+	if (stash == NULL) return;
+	*hits = stash->nhits;
+	*misses = stash->nmisses;
+	*rasters = stash->nrasters;
+}
+
 FONS_DEF int fonsExpandAtlas(FONScontext* stash, int width, int height)
 {
 	int i, maxy = 0;
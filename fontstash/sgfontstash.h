@@ -12,6 +12,11 @@ unsigned int sgfons_rgba(unsigned char r,
                          unsigned char b,
                          unsigned char a);
 
+void sgfons_capture(FONScontext *ctx,
+                    unsigned char *cov,
+                    int x, int y,
+                    int w, int h);
+
 #endif
 
 #ifdef SG_FONTSTASH_IMPLEMENTATION
@@ -21,6 +26,11 @@ struct SGFONScontext {
 	int width, height;
     const unsigned char *tex;
     sg_video *v;
+
+    /* while set, quads go to this coverage bitmap instead */
+    unsigned char *cap;
+    int capx, capy;
+    int capw, caph;
 };
 typedef struct SGFONScontext SGFONScontext;
 
@@ -53,46 +63,79 @@ static void draw_tex(sg_video *v,
                      int w, int h,
                      int r, int g, int b, int a)
 {
-    int x, y;
-
-    /* pos = ypos * stride + xpos * 3; */
-    for (y = 0; y < h; y++) {
-        for (x = 0; x < w; x++) {
-            double c;
-            unsigned char oclr[3];
-            int iclr[3];
-            int rc;
-
-
-            iclr[0] = 0;
-            iclr[1] = 0;
-            iclr[2] = 0;
-
-            rc = sg_video_get(v, xpos + x, ypos + y,
-                              &iclr[0], &iclr[1], &iclr[2]);
+    int x0, x1;
+    int y0, y1;
+    int fw, fh;
+    uint32_t clr;
+    uint16_t *lin;
+    size_t pos;
+
+    sg_video_dims(v, &fw, &fh);
+
+    /* clip the quad to the frame */
+    x0 = xpos < 0 ? -xpos : 0;
+    y0 = ypos < 0 ? -ypos : 0;
+    x1 = w;
+    y1 = h;
+    if (xpos + x1 > fw) x1 = fw - xpos;
+    if (ypos + y1 > fh) y1 = fh - ypos;
+
+    if (x0 >= x1 || y0 >= y1) return;
+
+    clr = (r & 0xff) << 16 | (g & 0xff) << 8 | (b & 0xff);
+    pos = (size_t)(ypos + y0) * fw + xpos + x0;
+    tex = &tex[(ty + y0) * tstride + tx + x0];
+
+    lin = sg_video_linbuf(v);
+
+    if (lin != NULL) {
+        sg_lin_glyph(&lin[pos * 4], fw, tex, tstride,
+                     x1 - x0, y1 - y0, clr, a / 255.f);
+    } else {
+        sg_colorlerp_glyph(&sg_video_cairobuf(v)[pos], fw, tex, tstride,
+                           x1 - x0, y1 - y0, clr, a / 255.f);
+    }
+}
 
-            if (!rc) continue;
+/*
+ * Coverage of a glyph quad onto the capture bitmap, composited
+ * over what is already there so overlapping glyphs add up the
+ * way they would on the frame.
+ */
+
+static void capture_tex(SGFONScontext *sgf,
+                        const unsigned char *tex,
+                        int tstride,
+                        int tx, int ty,
+                        int xpos, int ypos,
+                        int w, int h)
+{
+    int x0, x1;
+    int y0, y1;
+    int x, y;
 
-            oclr[0] = iclr[0];
-            oclr[1] = iclr[1];
-            oclr[2] = iclr[2];
+    xpos -= sgf->capx;
+    ypos -= sgf->capy;
 
-            c = (tex[(ty + y) * tstride + (tx + x)]/(double)0xff);
-            if (a < 0xff) c *= (double) a / 0xff;
+    x0 = xpos < 0 ? -xpos : 0;
+    y0 = ypos < 0 ? -ypos : 0;
+    x1 = w;
+    y1 = h;
+    if (xpos + x1 > sgf->capw) x1 = sgf->capw - xpos;
+    if (ypos + y1 > sgf->caph) y1 = sgf->caph - ypos;
 
-            /* oclr[0] = (c * r + (1 - c)*iclr[0]); */
-            /* oclr[1] = (c * g + (1 - c)*iclr[1]); */
-            /* oclr[2] = (c * b + (1 - c)*iclr[2]); */
+    for (y = y0; y < y1; y++) {
+        unsigned char *d;
+        const unsigned char *t;
 
-            sg_colorlerp(iclr[0], iclr[1], iclr[2],
-                         r, g, b,
-                         c,
-                         &oclr[0], &oclr[1], &oclr[2]);
+        d = &sgf->cap[(ypos + y) * sgf->capw + xpos + x0];
+        t = &tex[(ty + y) * tstride + tx + x0];
 
-            sg_video_set(v,
-                         xpos + x,
-                         ypos + y,
-                         oclr[0], oclr[1], oclr[2]);
+        for (x = 0; x < x1 - x0; x++) {
+            int c;
+            c = t[x];
+            if (c == 0) continue;
+            d[x] += (c * (255 - d[x]) + 127) / 255;
         }
     }
 }
@@ -134,11 +177,18 @@ static void renderDraw(void* ud,
         tw = tcoords[tpos + 2] * sgf->width - tx;
         th = tcoords[tpos + 3] * sgf->height - ty;
 
-        draw_tex(sgf->v, sgf->tex, sgf->width,
-                 tx, ty,
-                 xpos, ypos,
-                 tw, th,
-                 r, g, b, a);
+        if (sgf->cap != NULL) {
+            capture_tex(sgf, sgf->tex, sgf->width,
+                        tx, ty,
+                        xpos, ypos,
+                        tw, th);
+        } else {
+            draw_tex(sgf->v, sgf->tex, sgf->width,
+                     tx, ty,
+                     xpos, ypos,
+                     tw, th,
+                     r, g, b, a);
+        }
         vpos+=12;
         tpos+=12;
         cpos++;
@@ -198,4 +248,25 @@ unsigned int sgfons_rgba(unsigned char r,
 {
 	return (r) | (g << 8) | (b << 16) | (a << 24);
 }
+
+/*
+ * Sends what is drawn to a w by h coverage bitmap with its
+ * corner at x, y, ignoring color. NULL draws to the frame
+ * again.
+ */
+
+void sgfons_capture(FONScontext *ctx,
+                    unsigned char *cov,
+                    int x, int y,
+                    int w, int h)
+{
+    SGFONScontext *sgf;
+
+    sgf = ctx->params.userPtr;
+    sgf->cap = cov;
+    sgf->capx = x;
+    sgf->capy = y;
+    sgf->capw = w;
+    sgf->caph = h;
+}
 #endif
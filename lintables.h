@@ -0,0 +1,386 @@
+#define LINTABLE_SIZE 4096
+static const float srgb2lin[] = {0, 0.000303526984, 0.000607053967, 0.000910580951, 0.00121410793, 0.00151763492,
+0.0018211619, 0.00212468888, 0.00242821587, 0.00273174285, 0.00303526984, 0.00334653576,
+0.00367650732, 0.00402471702, 0.00439144204, 0.00477695348, 0.0051815167, 0.00560539162,
+0.00604883302, 0.00651209079, 0.00699541019, 0.00749903204, 0.00802319299, 0.00856812562,
+0.0091340587, 0.00972121732, 0.010329823, 0.010960094, 0.0116122452, 0.0122864884,
+0.0129830323, 0.013702083, 0.0144438436, 0.0152085144, 0.0159962934, 0.0168073758,
+0.0176419545, 0.0185002201, 0.019382361, 0.0202885631, 0.0212190104, 0.0221738848,
+0.0231533662, 0.0241576324, 0.0251868596, 0.0262412219, 0.0273208916, 0.0284260395,
+0.0295568344, 0.0307134437, 0.0318960331, 0.0331047666, 0.0343398068, 0.0356013149,
+0.0368894504, 0.0382043716, 0.0395462353, 0.0409151969, 0.0423114106, 0.0437350293,
+0.0451862044, 0.0466650863, 0.0481718242, 0.049706566, 0.0512694584, 0.052860647,
+0.0544802764, 0.05612849, 0.0578054302, 0.0595112382, 0.0612460542, 0.0630100177,
+0.0648032667, 0.0666259386, 0.0684781698, 0.0703600957, 0.0722718507, 0.0742135684,
+0.0761853815, 0.0781874218, 0.0802198203, 0.0822827071, 0.0843762115, 0.086500462,
+0.0886555863, 0.0908417112, 0.0930589628, 0.0953074666, 0.0975873471, 0.0998987282,
+0.102241733, 0.104616484, 0.107023103, 0.109461711, 0.111932428, 0.114435374,
+0.116970668, 0.119538428, 0.122138772, 0.124771818, 0.12743768, 0.130136477,
+0.132868322, 0.13563333, 0.138431615, 0.141263291, 0.144128471, 0.147027266,
+0.14995979, 0.152926152, 0.155926464, 0.158960835, 0.162029376, 0.165132195,
+0.1682694, 0.171441101, 0.174647404, 0.177888416, 0.181164244, 0.184474995,
+0.187820772, 0.191201683, 0.19461783, 0.19806932, 0.201556254, 0.205078736,
+0.20863687, 0.212230757, 0.2158605, 0.2195262, 0.223227957, 0.226965874,
+0.230740049, 0.234550582, 0.238397574, 0.242281122, 0.246201327, 0.250158285,
+0.254152094, 0.258182853, 0.262250658, 0.266355605, 0.270497791, 0.274677312,
+0.278894263, 0.28314874, 0.287440838, 0.29177065, 0.296138271, 0.300543794,
+0.304987314, 0.309468923, 0.313988713, 0.318546778, 0.323143209, 0.327778098,
+0.332451536, 0.337163615, 0.341914425, 0.346704056, 0.3515326, 0.356400144,
+0.36130678, 0.366252596, 0.37123768, 0.376262123, 0.381326011, 0.386429434,
+0.391572478, 0.396755231, 0.40197778, 0.407240212, 0.412542613, 0.417885071,
+0.42326767, 0.428690497, 0.434153636, 0.439657174, 0.445201195, 0.450785783,
+0.456411023, 0.462077, 0.467783796, 0.473531496, 0.479320183, 0.48514994,
+0.49102085, 0.496932995, 0.502886458, 0.508881321, 0.514917665, 0.520995573,
+0.527115126, 0.533276404, 0.539479489, 0.545724461, 0.552011402, 0.55834039,
+0.564711506, 0.571124829, 0.57758044, 0.584078418, 0.590618841, 0.597201788,
+0.603827339, 0.610495571, 0.617206562, 0.623960392, 0.630757136, 0.637596874,
+0.644479682, 0.651405637, 0.658374817, 0.665387298, 0.672443157, 0.67954247,
+0.686685312, 0.693871761, 0.701101892, 0.70837578, 0.715693501, 0.723055129,
+0.73046074, 0.737910409, 0.74540421, 0.752942217, 0.760524505, 0.768151147,
+0.775822218, 0.783537792, 0.79129794, 0.799102738, 0.806952258, 0.814846572,
+0.822785754, 0.830769877, 0.838799012, 0.846873232, 0.854992608, 0.863157213,
+0.871367119, 0.879622397, 0.887923118, 0.896269353, 0.904661174, 0.913098652,
+0.921581856, 0.930110858, 0.938685728, 0.947306537, 0.955973353, 0.964686248,
+0.97344529, 0.98225055, 0.991102097, 1, };
+static const uint8_t lin2srgb[] = {0, 1, 2, 2, 3, 4, 5, 6, 6, 7, 8, 9,
+10, 10, 11, 12, 13, 13, 14, 15, 15, 16, 16, 17,
+18, 18, 19, 19, 20, 20, 21, 21, 22, 22, 23, 23,
+23, 24, 24, 25, 25, 25, 26, 26, 27, 27, 27, 28,
+28, 29, 29, 29, 30, 30, 30, 31, 31, 31, 32, 32,
+32, 33, 33, 33, 34, 34, 34, 34, 35, 35, 35, 36,
+36, 36, 37, 37, 37, 37, 38, 38, 38, 38, 39, 39,
+39, 40, 40, 40, 40, 41, 41, 41, 41, 42, 42, 42,
+42, 43, 43, 43, 43, 43, 44, 44, 44, 44, 45, 45,
+45, 45, 46, 46, 46, 46, 46, 47, 47, 47, 47, 48,
+48, 48, 48, 48, 49, 49, 49, 49, 49, 50, 50, 50,
+50, 50, 51, 51, 51, 51, 51, 52, 52, 52, 52, 52,
+53, 53, 53, 53, 53, 54, 54, 54, 54, 54, 55, 55,
+55, 55, 55, 55, 56, 56, 56, 56, 56, 57, 57, 57,
+57, 57, 57, 58, 58, 58, 58, 58, 58, 59, 59, 59,
+59, 59, 59, 60, 60, 60, 60, 60, 60, 61, 61, 61,
+61, 61, 61, 62, 62, 62, 62, 62, 62, 63, 63, 63,
+63, 63, 63, 64, 64, 64, 64, 64, 64, 64, 65, 65,
+65, 65, 65, 65, 66, 66, 66, 66, 66, 66, 66, 67,
+67, 67, 67, 67, 67, 67, 68, 68, 68, 68, 68, 68,
+68, 69, 69, 69, 69, 69, 69, 69, 70, 70, 70, 70,
+70, 70, 70, 71, 71, 71, 71, 71, 71, 71, 72, 72,
+72, 72, 72, 72, 72, 72, 73, 73, 73, 73, 73, 73,
+73, 74, 74, 74, 74, 74, 74, 74, 74, 75, 75, 75,
+75, 75, 75, 75, 75, 76, 76, 76, 76, 76, 76, 76,
+77, 77, 77, 77, 77, 77, 77, 77, 78, 78, 78, 78,
+78, 78, 78, 78, 78, 79, 79, 79, 79, 79, 79, 79,
+79, 80, 80, 80, 80, 80, 80, 80, 80, 81, 81, 81,
+81, 81, 81, 81, 81, 81, 82, 82, 82, 82, 82, 82,
+82, 82, 83, 83, 83, 83, 83, 83, 83, 83, 83, 84,
+84, 84, 84, 84, 84, 84, 84, 84, 85, 85, 85, 85,
+85, 85, 85, 85, 85, 86, 86, 86, 86, 86, 86, 86,
+86, 86, 87, 87, 87, 87, 87, 87, 87, 87, 87, 88,
+88, 88, 88, 88, 88, 88, 88, 88, 88, 89, 89, 89,
+89, 89, 89, 89, 89, 89, 90, 90, 90, 90, 90, 90,
+90, 90, 90, 90, 91, 91, 91, 91, 91, 91, 91, 91,
+91, 91, 92, 92, 92, 92, 92, 92, 92, 92, 92, 92,
+93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 94, 94,
+94, 94, 94, 94, 94, 94, 94, 94, 95, 95, 95, 95,
+95, 95, 95, 95, 95, 95, 96, 96, 96, 96, 96, 96,
+96, 96, 96, 96, 96, 97, 97, 97, 97, 97, 97, 97,
+97, 97, 97, 98, 98, 98, 98, 98, 98, 98, 98, 98,
+98, 98, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+99, 100, 100, 100, 100, 100, 100, 100, 100, 100, 100, 100,
+101, 101, 101, 101, 101, 101, 101, 101, 101, 101, 101, 102,
+102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 103, 103,
+103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 104, 104,
+104, 104, 104, 104, 104, 104, 104, 104, 104, 105, 105, 105,
+105, 105, 105, 105, 105, 105, 105, 105, 105, 106, 106, 106,
+106, 106, 106, 106, 106, 106, 106, 106, 106, 107, 107, 107,
+107, 107, 107, 107, 107, 107, 107, 107, 107, 108, 108, 108,
+108, 108, 108, 108, 108, 108, 108, 108, 108, 109, 109, 109,
+109, 109, 109, 109, 109, 109, 109, 109, 109, 110, 110, 110,
+110, 110, 110, 110, 110, 110, 110, 110, 110, 111, 111, 111,
+111, 111, 111, 111, 111, 111, 111, 111, 111, 111, 112, 112,
+112, 112, 112, 112, 112, 112, 112, 112, 112, 112, 113, 113,
+113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 114,
+114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114,
+115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115,
+115, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116,
+116, 116, 117, 117, 117, 117, 117, 117, 117, 117, 117, 117,
+117, 117, 117, 117, 118, 118, 118, 118, 118, 118, 118, 118,
+118, 118, 118, 118, 118, 119, 119, 119, 119, 119, 119, 119,
+119, 119, 119, 119, 119, 119, 119, 120, 120, 120, 120, 120,
+120, 120, 120, 120, 120, 120, 120, 120, 120, 121, 121, 121,
+121, 121, 121, 121, 121, 121, 121, 121, 121, 121, 122, 122,
+122, 122, 122, 122, 122, 122, 122, 122, 122, 122, 122, 122,
+122, 123, 123, 123, 123, 123, 123, 123, 123, 123, 123, 123,
+123, 123, 123, 124, 124, 124, 124, 124, 124, 124, 124, 124,
+124, 124, 124, 124, 124, 125, 125, 125, 125, 125, 125, 125,
+125, 125, 125, 125, 125, 125, 125, 125, 126, 126, 126, 126,
+126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 127, 127,
+127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127,
+127, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+128, 128, 128, 128, 129, 129, 129, 129, 129, 129, 129, 129,
+129, 129, 129, 129, 129, 129, 129, 130, 130, 130, 130, 130,
+130, 130, 130, 130, 130, 130, 130, 130, 130, 130, 131, 131,
+131, 131, 131, 131, 131, 131, 131, 131, 131, 131, 131, 131,
+131, 131, 132, 132, 132, 132, 132, 132, 132, 132, 132, 132,
+132, 132, 132, 132, 132, 133, 133, 133, 133, 133, 133, 133,
+133, 133, 133, 133, 133, 133, 133, 133, 133, 134, 134, 134,
+134, 134, 134, 134, 134, 134, 134, 134, 134, 134, 134, 134,
+134, 135, 135, 135, 135, 135, 135, 135, 135, 135, 135, 135,
+135, 135, 135, 135, 135, 136, 136, 136, 136, 136, 136, 136,
+136, 136, 136, 136, 136, 136, 136, 136, 136, 137, 137, 137,
+137, 137, 137, 137, 137, 137, 137, 137, 137, 137, 137, 137,
+137, 138, 138, 138, 138, 138, 138, 138, 138, 138, 138, 138,
+138, 138, 138, 138, 138, 139, 139, 139, 139, 139, 139, 139,
+139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 140, 140,
+140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 140,
+140, 140, 140, 141, 141, 141, 141, 141, 141, 141, 141, 141,
+141, 141, 141, 141, 141, 141, 141, 141, 142, 142, 142, 142,
+142, 142, 142, 142, 142, 142, 142, 142, 142, 142, 142, 142,
+142, 143, 143, 143, 143, 143, 143, 143, 143, 143, 143, 143,
+143, 143, 143, 143, 143, 143, 144, 144, 144, 144, 144, 144,
+144, 144, 144, 144, 144, 144, 144, 144, 144, 144, 144, 145,
+145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145,
+145, 145, 145, 145, 145, 146, 146, 146, 146, 146, 146, 146,
+146, 146, 146, 146, 146, 146, 146, 146, 146, 146, 147, 147,
+147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147,
+147, 147, 147, 147, 148, 148, 148, 148, 148, 148, 148, 148,
+148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 149, 149,
+149, 149, 149, 149, 149, 149, 149, 149, 149, 149, 149, 149,
+149, 149, 149, 149, 150, 150, 150, 150, 150, 150, 150, 150,
+150, 150, 150, 150, 150, 150, 150, 150, 150, 150, 150, 151,
+151, 151, 151, 151, 151, 151, 151, 151, 151, 151, 151, 151,
+151, 151, 151, 151, 151, 152, 152, 152, 152, 152, 152, 152,
+152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152,
+153, 153, 153, 153, 153, 153, 153, 153, 153, 153, 153, 153,
+153, 153, 153, 153, 153, 153, 154, 154, 154, 154, 154, 154,
+154, 154, 154, 154, 154, 154, 154, 154, 154, 154, 154, 154,
+154, 155, 155, 155, 155, 155, 155, 155, 155, 155, 155, 155,
+155, 155, 155, 155, 155, 155, 155, 155, 156, 156, 156, 156,
+156, 156, 156, 156, 156, 156, 156, 156, 156, 156, 156, 156,
+156, 156, 156, 156, 157, 157, 157, 157, 157, 157, 157, 157,
+157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 158,
+158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158,
+158, 158, 158, 158, 158, 158, 159, 159, 159, 159, 159, 159,
+159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159,
+159, 159, 160, 160, 160, 160, 160, 160, 160, 160, 160, 160,
+160, 160, 160, 160, 160, 160, 160, 160, 160, 160, 161, 161,
+161, 161, 161, 161, 161, 161, 161, 161, 161, 161, 161, 161,
+161, 161, 161, 161, 161, 161, 162, 162, 162, 162, 162, 162,
+162, 162, 162, 162, 162, 162, 162, 162, 162, 162, 162, 162,
+162, 162, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163,
+163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 164, 164,
+164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 164,
+164, 164, 164, 164, 164, 164, 164, 165, 165, 165, 165, 165,
+165, 165, 165, 165, 165, 165, 165, 165, 165, 165, 165, 165,
+165, 165, 165, 165, 166, 166, 166, 166, 166, 166, 166, 166,
+166, 166, 166, 166, 166, 166, 166, 166, 166, 166, 166, 166,
+167, 167, 167, 167, 167, 167, 167, 167, 167, 167, 167, 167,
+167, 167, 167, 167, 167, 167, 167, 167, 167, 168, 168, 168,
+168, 168, 168, 168, 168, 168, 168, 168, 168, 168, 168, 168,
+168, 168, 168, 168, 168, 168, 168, 169, 169, 169, 169, 169,
+169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169,
+169, 169, 169, 169, 170, 170, 170, 170, 170, 170, 170, 170,
+170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170,
+170, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171,
+171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 172,
+172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172,
+172, 172, 172, 172, 172, 172, 172, 172, 172, 173, 173, 173,
+173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 173,
+173, 173, 173, 173, 173, 173, 173, 174, 174, 174, 174, 174,
+174, 174, 174, 174, 174, 174, 174, 174, 174, 174, 174, 174,
+174, 174, 174, 174, 174, 175, 175, 175, 175, 175, 175, 175,
+175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175,
+175, 175, 175, 176, 176, 176, 176, 176, 176, 176, 176, 176,
+176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176,
+176, 176, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177,
+177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177,
+178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 178,
+178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 179,
+179, 179, 179, 179, 179, 179, 179, 179, 179, 179, 179, 179,
+179, 179, 179, 179, 179, 179, 179, 179, 179, 179, 180, 180,
+180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180,
+180, 180, 180, 180, 180, 180, 180, 180, 180, 181, 181, 181,
+181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181,
+181, 181, 181, 181, 181, 181, 181, 181, 182, 182, 182, 182,
+182, 182, 182, 182, 182, 182, 182, 182, 182, 182, 182, 182,
+182, 182, 182, 182, 182, 182, 182, 182, 183, 183, 183, 183,
+183, 183, 183, 183, 183, 183, 183, 183, 183, 183, 183, 183,
+183, 183, 183, 183, 183, 183, 183, 184, 184, 184, 184, 184,
+184, 184, 184, 184, 184, 184, 184, 184, 184, 184, 184, 184,
+184, 184, 184, 184, 184, 184, 184, 185, 185, 185, 185, 185,
+185, 185, 185, 185, 185, 185, 185, 185, 185, 185, 185, 185,
+185, 185, 185, 185, 185, 185, 185, 186, 186, 186, 186, 186,
+186, 186, 186, 186, 186, 186, 186, 186, 186, 186, 186, 186,
+186, 186, 186, 186, 186, 186, 186, 187, 187, 187, 187, 187,
+187, 187, 187, 187, 187, 187, 187, 187, 187, 187, 187, 187,
+187, 187, 187, 187, 187, 187, 187, 187, 188, 188, 188, 188,
+188, 188, 188, 188, 188, 188, 188, 188, 188, 188, 188, 188,
+188, 188, 188, 188, 188, 188, 188, 188, 189, 189, 189, 189,
+189, 189, 189, 189, 189, 189, 189, 189, 189, 189, 189, 189,
+189, 189, 189, 189, 189, 189, 189, 189, 189, 190, 190, 190,
+190, 190, 190, 190, 190, 190, 190, 190, 190, 190, 190, 190,
+190, 190, 190, 190, 190, 190, 190, 190, 190, 190, 191, 191,
+191, 191, 191, 191, 191, 191, 191, 191, 191, 191, 191, 191,
+191, 191, 191, 191, 191, 191, 191, 191, 191, 191, 192, 192,
+192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192,
+192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192,
+193, 193, 193, 193, 193, 193, 193, 193, 193, 193, 193, 193,
+193, 193, 193, 193, 193, 193, 193, 193, 193, 193, 193, 193,
+193, 194, 194, 194, 194, 194, 194, 194, 194, 194, 194, 194,
+194, 194, 194, 194, 194, 194, 194, 194, 194, 194, 194, 194,
+194, 194, 195, 195, 195, 195, 195, 195, 195, 195, 195, 195,
+195, 195, 195, 195, 195, 195, 195, 195, 195, 195, 195, 195,
+195, 195, 195, 195, 196, 196, 196, 196, 196, 196, 196, 196,
+196, 196, 196, 196, 196, 196, 196, 196, 196, 196, 196, 196,
+196, 196, 196, 196, 196, 196, 197, 197, 197, 197, 197, 197,
+197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197,
+197, 197, 197, 197, 197, 197, 197, 197, 198, 198, 198, 198,
+198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198,
+198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 199, 199,
+199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199,
+199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199,
+200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200,
+200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200,
+200, 200, 200, 201, 201, 201, 201, 201, 201, 201, 201, 201,
+201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201,
+201, 201, 201, 201, 201, 201, 202, 202, 202, 202, 202, 202,
+202, 202, 202, 202, 202, 202, 202, 202, 202, 202, 202, 202,
+202, 202, 202, 202, 202, 202, 202, 202, 202, 203, 203, 203,
+203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203,
+203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203,
+204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204,
+204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204,
+204, 204, 204, 205, 205, 205, 205, 205, 205, 205, 205, 205,
+205, 205, 205, 205, 205, 205, 205, 205, 205, 205, 205, 205,
+205, 205, 205, 205, 205, 205, 206, 206, 206, 206, 206, 206,
+206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206,
+206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 207, 207,
+207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207,
+207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207,
+207, 207, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208,
+208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208,
+208, 208, 208, 208, 208, 209, 209, 209, 209, 209, 209, 209,
+209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 209,
+209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 210, 210,
+210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210,
+210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210,
+210, 210, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211,
+211, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211,
+211, 211, 211, 211, 211, 211, 212, 212, 212, 212, 212, 212,
+212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212,
+212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 213,
+213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213,
+213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213,
+213, 213, 213, 213, 214, 214, 214, 214, 214, 214, 214, 214,
+214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214,
+214, 214, 214, 214, 214, 214, 214, 214, 214, 215, 215, 215,
+215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215,
+215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215,
+215, 215, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216,
+216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216,
+216, 216, 216, 216, 216, 216, 216, 217, 217, 217, 217, 217,
+217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217,
+217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217,
+217, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218,
+218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218,
+218, 218, 218, 218, 218, 218, 219, 219, 219, 219, 219, 219,
+219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219,
+219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219,
+220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220,
+220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220,
+220, 220, 220, 220, 220, 220, 221, 221, 221, 221, 221, 221,
+221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221,
+221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221,
+221, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222,
+222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222,
+222, 222, 222, 222, 222, 222, 222, 223, 223, 223, 223, 223,
+223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223,
+223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223,
+223, 223, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224,
+224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224,
+224, 224, 224, 224, 224, 224, 224, 224, 225, 225, 225, 225,
+225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225,
+225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225,
+225, 225, 225, 226, 226, 226, 226, 226, 226, 226, 226, 226,
+226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226,
+226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 227, 227,
+227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227,
+227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227,
+227, 227, 227, 227, 227, 227, 228, 228, 228, 228, 228, 228,
+228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228,
+228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228,
+228, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229,
+229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229,
+229, 229, 229, 229, 229, 229, 229, 229, 229, 230, 230, 230,
+230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230,
+230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230,
+230, 230, 230, 230, 230, 231, 231, 231, 231, 231, 231, 231,
+231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231,
+231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231,
+231, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232,
+232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232,
+232, 232, 232, 232, 232, 232, 232, 232, 232, 233, 233, 233,
+233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233,
+233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233,
+233, 233, 233, 233, 233, 233, 234, 234, 234, 234, 234, 234,
+234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234,
+234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234,
+234, 234, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235,
+235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235,
+235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 236,
+236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236,
+236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236,
+236, 236, 236, 236, 236, 236, 236, 236, 237, 237, 237, 237,
+237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237,
+237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237,
+237, 237, 237, 237, 237, 238, 238, 238, 238, 238, 238, 238,
+238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238,
+238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238,
+238, 238, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239,
+239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239,
+239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239,
+240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240,
+240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240,
+240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 241, 241,
+241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241,
+241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241,
+241, 241, 241, 241, 241, 241, 241, 241, 242, 242, 242, 242,
+242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242,
+242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242,
+242, 242, 242, 242, 242, 242, 243, 243, 243, 243, 243, 243,
+243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243,
+243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243,
+243, 243, 243, 243, 244, 244, 244, 244, 244, 244, 244, 244,
+244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244,
+244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244,
+244, 244, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245,
+245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245,
+245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245,
+245, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246,
+246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246,
+246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246,
+247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247,
+247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247,
+247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 248,
+248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248,
+248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248,
+248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 249, 249,
+249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249,
+249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249,
+249, 249, 249, 249, 249, 249, 249, 249, 249, 250, 250, 250,
+250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250,
+250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250,
+250, 250, 250, 250, 250, 250, 250, 250, 250, 251, 251, 251,
+251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251,
+251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251,
+251, 251, 251, 251, 251, 251, 251, 251, 251, 252, 252, 252,
+252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252,
+252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252,
+252, 252, 252, 252, 252, 252, 252, 252, 252, 253, 253, 253,
+253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253,
+253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253,
+253, 253, 253, 253, 253, 253, 253, 253, 253, 254, 254, 254,
+254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254,
+254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254,
+254, 254, 254, 254, 254, 254, 254, 254, 254, 255, 255, 255,
+255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+255, 255, 255, 255, };
@@ -0,0 +1,582 @@
+/*
+ * Copyright (c) 2021 Muvik Labs, LLC
+ * Distributed under the MIT license.
+ */
+
+/*
+ * A minimal progressive MP4 writer for a single H.264
+ * track. Samples are written into mdat as they arrive,
+ * and the sample tables are kept in memory until
+ * sg_mp4_del, which writes the moov box at the end of
+ * the file.
+ *
+ * Samples are expected in the length-prefixed form x264
+ * produces with b_annexb turned off. SPS and PPS go into
+ * the avcC box instead of the stream.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "mp4.h"
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t cap;
+} mp4buf;
+
+typedef struct {
+    uint32_t size;
+    uint64_t offset;
+    int64_t pts;
+    int64_t dts;
+    int keyframe;
+} mp4sample;
+
+struct sg_mp4 {
+    FILE *fp;
+    int w, h;
+    int fps;
+    uint8_t *sps;
+    int sps_sz;
+    uint8_t *pps;
+    int pps_sz;
+    long mdat_pos;
+    uint64_t pos;
+    mp4sample *samples;
+    int nsamples;
+    int cap;
+};
+
+static void buf_put(mp4buf *b, const void *data, size_t sz)
+{
+    if (b->size + sz > b->cap) {
+        b->cap = (b->size + sz) * 2;
+        b->data = realloc(b->data, b->cap);
+    }
+
+    memcpy(b->data + b->size, data, sz);
+    b->size += sz;
+}
+
+static void put8(mp4buf *b, uint32_t x)
+{
+    uint8_t c;
+    c = x & 0xff;
+    buf_put(b, &c, 1);
+}
+
+static void put16(mp4buf *b, uint32_t x)
+{
+    put8(b, x >> 8);
+    put8(b, x);
+}
+
+static void put32(mp4buf *b, uint32_t x)
+{
+    put16(b, x >> 16);
+    put16(b, x);
+}
+
+static void put64(mp4buf *b, uint64_t x)
+{
+    put32(b, (uint32_t)(x >> 32));
+    put32(b, (uint32_t)x);
+}
+
+static void putzero(mp4buf *b, int n)
+{
+    while (n--) put8(b, 0);
+}
+
+/* box_open returns the start, box_close patches the size */
+
+static size_t box_open(mp4buf *b, const char *type)
+{
+    size_t start;
+
+    start = b->size;
+    put32(b, 0);
+    buf_put(b, type, 4);
+
+    return start;
+}
+
+static size_t fullbox_open(mp4buf *b, const char *type,
+                           int version, uint32_t flags)
+{
+    size_t start;
+
+    start = box_open(b, type);
+    put32(b, (version << 24) | flags);
+
+    return start;
+}
+
+static void box_close(mp4buf *b, size_t start)
+{
+    uint32_t sz;
+    uint8_t *p;
+
+    sz = b->size - start;
+    p = b->data + start;
+    p[0] = sz >> 24;
+    p[1] = sz >> 16;
+    p[2] = sz >> 8;
+    p[3] = sz;
+}
+
+static void put_matrix(mp4buf *b)
+{
+    put32(b, 0x00010000);
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, 0x00010000);
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, 0x40000000);
+}
+
+int sg_mp4_new(sg_mp4 **pm, FILE *fp, int w, int h, int fps)
+{
+    sg_mp4 *m;
+    mp4buf b;
+    size_t box;
+
+    m = calloc(1, sizeof(sg_mp4));
+
+    if (m == NULL) return 0;
+
+    m->fp = fp;
+    m->w = w;
+    m->h = h;
+    m->fps = fps;
+
+    b.data = NULL;
+    b.size = b.cap = 0;
+
+    box = box_open(&b, "ftyp");
+    buf_put(&b, "isom", 4);
+    put32(&b, 0x200);
+    buf_put(&b, "isom", 4);
+    buf_put(&b, "iso2", 4);
+    buf_put(&b, "avc1", 4);
+    buf_put(&b, "mp41", 4);
+    box_close(&b, box);
+
+    /* 64-bit mdat header, size is patched at the end */
+    put32(&b, 1);
+    buf_put(&b, "mdat", 4);
+    put64(&b, 0);
+
+    m->mdat_pos = b.size - 16;
+    m->pos = b.size;
+
+    if (fwrite(b.data, 1, b.size, fp) != b.size) {
+        free(b.data);
+        free(m);
+        return 0;
+    }
+
+    free(b.data);
+
+    *pm = m;
+    return 1;
+}
+
+void sg_mp4_sps(sg_mp4 *m, const uint8_t *sps, int sz)
+{
+    free(m->sps);
+    m->sps = malloc(sz);
+    memcpy(m->sps, sps, sz);
+    m->sps_sz = sz;
+}
+
+void sg_mp4_pps(sg_mp4 *m, const uint8_t *pps, int sz)
+{
+    free(m->pps);
+    m->pps = malloc(sz);
+    memcpy(m->pps, pps, sz);
+    m->pps_sz = sz;
+}
+
+void sg_mp4_write(sg_mp4 *m,
+                  const uint8_t *data, int sz,
+                  int keyframe,
+                  int64_t pts, int64_t dts)
+{
+    mp4sample *s;
+
+    if (m->nsamples >= m->cap) {
+        m->cap = m->cap ? m->cap * 2 : 256;
+        m->samples = realloc(m->samples, sizeof(mp4sample) * m->cap);
+    }
+
+    s = &m->samples[m->nsamples];
+    s->size = sz;
+    s->offset = m->pos;
+    s->pts = pts;
+    s->dts = dts;
+    s->keyframe = keyframe;
+    m->nsamples++;
+
+    fwrite(data, 1, sz, m->fp);
+    m->pos += sz;
+}
+
+/*
+ * Just enough of an SPS parser to fill in the avcC
+ * extension that the high profiles require.
+ */
+
+typedef struct {
+    const uint8_t *data;
+    int sz;
+    int pos;
+    int zeros;
+    int byte;
+    int bit;
+} bitreader;
+
+static int read_bit(bitreader *br)
+{
+    if (br->bit == 0) {
+        if (br->pos >= br->sz) return 0;
+        br->byte = br->data[br->pos++];
+
+        /* skip emulation prevention bytes */
+        if (br->zeros >= 2 && br->byte == 3) {
+            br->zeros = 0;
+            if (br->pos >= br->sz) return 0;
+            br->byte = br->data[br->pos++];
+        }
+
+        if (br->byte == 0) br->zeros++;
+        else br->zeros = 0;
+
+        br->bit = 8;
+    }
+
+    br->bit--;
+    return (br->byte >> br->bit) & 1;
+}
+
+static uint32_t read_ue(bitreader *br)
+{
+    int nzeros;
+    uint32_t x;
+
+    nzeros = 0;
+    while (read_bit(br) == 0 && nzeros < 32) nzeros++;
+
+    x = 0;
+    while (nzeros--) x = (x << 1) | read_bit(br);
+
+    return x;
+}
+
+static void put_avcc(sg_mp4 *m, mp4buf *b)
+{
+    size_t box;
+    int profile;
+
+    box = box_open(b, "avcC");
+    profile = m->sps_sz > 1 ? m->sps[1] : 0;
+    put8(b, 1);
+    put8(b, profile);
+    put8(b, m->sps_sz > 2 ? m->sps[2] : 0);
+    put8(b, m->sps_sz > 3 ? m->sps[3] : 0);
+    /* 4-byte NAL lengths */
+    put8(b, 0xfc | 3);
+    put8(b, 0xe0 | 1);
+    put16(b, m->sps_sz);
+    buf_put(b, m->sps, m->sps_sz);
+    put8(b, 1);
+    put16(b, m->pps_sz);
+    buf_put(b, m->pps, m->pps_sz);
+
+    if (profile == 100 || profile == 110 ||
+        profile == 122 || profile == 244) {
+        bitreader br;
+        uint32_t chroma, luma_depth, chroma_depth;
+
+        /* skip NAL header, profile, constraints, and level */
+        br.data = m->sps + 4;
+        br.sz = m->sps_sz - 4;
+        br.pos = 0;
+        br.zeros = 0;
+        br.bit = 0;
+
+        read_ue(&br);
+        chroma = read_ue(&br);
+        if (chroma == 3) read_bit(&br);
+        luma_depth = read_ue(&br);
+        chroma_depth = read_ue(&br);
+
+        put8(b, 0xfc | (chroma & 3));
+        put8(b, 0xf8 | (luma_depth & 7));
+        put8(b, 0xf8 | (chroma_depth & 7));
+        put8(b, 0);
+    }
+
+    box_close(b, box);
+}
+
+static void put_stsd(sg_mp4 *m, mp4buf *b)
+{
+    size_t stsd, avc1;
+
+    stsd = fullbox_open(b, "stsd", 0, 0);
+    put32(b, 1);
+
+    avc1 = box_open(b, "avc1");
+    putzero(b, 6);
+    put16(b, 1);
+    putzero(b, 16);
+    put16(b, m->w);
+    put16(b, m->h);
+    put32(b, 0x00480000);
+    put32(b, 0x00480000);
+    put32(b, 0);
+    put16(b, 1);
+    putzero(b, 32);
+    put16(b, 0x0018);
+    put16(b, 0xffff);
+    put_avcc(m, b);
+    box_close(b, avc1);
+
+    box_close(b, stsd);
+}
+
+/* sample durations come from the decode timestamps */
+
+static uint32_t sample_delta(sg_mp4 *m, int i)
+{
+    if (i + 1 < m->nsamples) {
+        return m->samples[i + 1].dts - m->samples[i].dts;
+    }
+
+    if (i > 0) return m->samples[i].dts - m->samples[i - 1].dts;
+
+    return 1;
+}
+
+static void put_stbl(sg_mp4 *m, mp4buf *b)
+{
+    size_t stbl, box;
+    size_t count_pos;
+    int i;
+    int nentries;
+    int need_ctts;
+    int nkeys;
+    int use64;
+
+    stbl = box_open(b, "stbl");
+
+    put_stsd(m, b);
+
+    /* stts: run-length coded sample durations */
+    box = fullbox_open(b, "stts", 0, 0);
+    count_pos = b->size;
+    put32(b, 0);
+    nentries = 0;
+    for (i = 0; i < m->nsamples;) {
+        uint32_t delta;
+        int n;
+
+        delta = sample_delta(m, i);
+        n = 1;
+        while (i + n < m->nsamples && sample_delta(m, i + n) == delta) n++;
+        put32(b, n);
+        put32(b, delta);
+        nentries++;
+        i += n;
+    }
+    b->data[count_pos] = nentries >> 24;
+    b->data[count_pos + 1] = nentries >> 16;
+    b->data[count_pos + 2] = nentries >> 8;
+    b->data[count_pos + 3] = nentries;
+    box_close(b, box);
+
+    /* ctts: only needed when frames are reordered */
+    need_ctts = 0;
+    for (i = 0; i < m->nsamples; i++) {
+        if (m->samples[i].pts != m->samples[i].dts) {
+            need_ctts = 1;
+            break;
+        }
+    }
+
+    if (need_ctts) {
+        box = fullbox_open(b, "ctts", 0, 0);
+        put32(b, m->nsamples);
+        for (i = 0; i < m->nsamples; i++) {
+            put32(b, 1);
+            put32(b, m->samples[i].pts - m->samples[i].dts);
+        }
+        box_close(b, box);
+    }
+
+    /* stss: omitted when every sample is a sync sample */
+    nkeys = 0;
+    for (i = 0; i < m->nsamples; i++) nkeys += m->samples[i].keyframe;
+
+    if (nkeys < m->nsamples) {
+        box = fullbox_open(b, "stss", 0, 0);
+        put32(b, nkeys);
+        for (i = 0; i < m->nsamples; i++) {
+            if (m->samples[i].keyframe) put32(b, i + 1);
+        }
+        box_close(b, box);
+    }
+
+    /* stsc: one sample per chunk */
+    box = fullbox_open(b, "stsc", 0, 0);
+    put32(b, 1);
+    put32(b, 1);
+    put32(b, 1);
+    put32(b, 1);
+    box_close(b, box);
+
+    box = fullbox_open(b, "stsz", 0, 0);
+    put32(b, 0);
+    put32(b, m->nsamples);
+    for (i = 0; i < m->nsamples; i++) put32(b, m->samples[i].size);
+    box_close(b, box);
+
+    use64 = m->pos > 0xffffffffUL;
+
+    box = fullbox_open(b, use64 ? "co64" : "stco", 0, 0);
+    put32(b, m->nsamples);
+    for (i = 0; i < m->nsamples; i++) {
+        if (use64) put64(b, m->samples[i].offset);
+        else put32(b, (uint32_t)m->samples[i].offset);
+    }
+    box_close(b, box);
+
+    box_close(b, stbl);
+}
+
+static void put_moov(sg_mp4 *m, mp4buf *b)
+{
+    size_t moov, trak, mdia, minf, dinf, dref;
+    size_t box;
+    uint32_t duration;
+    int i;
+
+    duration = 0;
+    for (i = 0; i < m->nsamples; i++) duration += sample_delta(m, i);
+
+    moov = box_open(b, "moov");
+
+    box = fullbox_open(b, "mvhd", 0, 0);
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, m->fps);
+    put32(b, duration);
+    put32(b, 0x00010000);
+    put16(b, 0x0100);
+    putzero(b, 10);
+    put_matrix(b);
+    putzero(b, 24);
+    put32(b, 2);
+    box_close(b, box);
+
+    trak = box_open(b, "trak");
+
+    /* enabled, in movie */
+    box = fullbox_open(b, "tkhd", 0, 3);
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, 1);
+    put32(b, 0);
+    put32(b, duration);
+    putzero(b, 8);
+    put16(b, 0);
+    put16(b, 0);
+    put16(b, 0);
+    put16(b, 0);
+    put_matrix(b);
+    put32(b, m->w << 16);
+    put32(b, m->h << 16);
+    box_close(b, box);
+
+    mdia = box_open(b, "mdia");
+
+    box = fullbox_open(b, "mdhd", 0, 0);
+    put32(b, 0);
+    put32(b, 0);
+    put32(b, m->fps);
+    put32(b, duration);
+    /* "und" */
+    put16(b, 0x55c4);
+    put16(b, 0);
+    box_close(b, box);
+
+    box = fullbox_open(b, "hdlr", 0, 0);
+    put32(b, 0);
+    buf_put(b, "vide", 4);
+    putzero(b, 12);
+    buf_put(b, "VideoHandler", 13);
+    box_close(b, box);
+
+    minf = box_open(b, "minf");
+
+    box = fullbox_open(b, "vmhd", 0, 1);
+    putzero(b, 8);
+    box_close(b, box);
+
+    dinf = box_open(b, "dinf");
+    dref = fullbox_open(b, "dref", 0, 0);
+    put32(b, 1);
+    /* self-contained */
+    box = fullbox_open(b, "url ", 0, 1);
+    box_close(b, box);
+    box_close(b, dref);
+    box_close(b, dinf);
+
+    put_stbl(m, b);
+
+    box_close(b, minf);
+    box_close(b, mdia);
+    box_close(b, trak);
+    box_close(b, moov);
+}
+
+/* finishes the file: patches mdat, then appends moov */
+
+void sg_mp4_del(sg_mp4 **pm)
+{
+    sg_mp4 *m;
+    mp4buf b;
+    uint64_t mdat_sz;
+
+    m = *pm;
+
+    if (m == NULL) return;
+
+    mdat_sz = m->pos - m->mdat_pos;
+
+    b.data = NULL;
+    b.size = b.cap = 0;
+    put64(&b, mdat_sz);
+    fseek(m->fp, m->mdat_pos + 8, SEEK_SET);
+    fwrite(b.data, 1, b.size, m->fp);
+    fseek(m->fp, 0, SEEK_END);
+
+    b.size = 0;
+    put_moov(m, &b);
+    fwrite(b.data, 1, b.size, m->fp);
+    free(b.data);
+
+    free(m->samples);
+    free(m->sps);
+    free(m->pps);
+    free(m);
+    *pm = NULL;
+}
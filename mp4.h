@@ -0,0 +1,15 @@
+#ifndef SG_MP4_H
+#define SG_MP4_H
+typedef struct sg_mp4 sg_mp4;
+
+int sg_mp4_new(sg_mp4 **pm, FILE *fp, int w, int h, int fps);
+void sg_mp4_del(sg_mp4 **pm);
+
+void sg_mp4_sps(sg_mp4 *m, const uint8_t *sps, int sz);
+void sg_mp4_pps(sg_mp4 *m, const uint8_t *pps, int sz);
+
+void sg_mp4_write(sg_mp4 *m,
+                  const uint8_t *data, int sz,
+                  int keyframe,
+                  int64_t pts, int64_t dts);
+#endif
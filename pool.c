@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2021 Muvik Labs, LLC
+ * Distributed under the MIT license.
+ */
+
+/*
+ * A persistent pool of worker threads with a parallel-for.
+ *
+ * sg_pool_run calls fn(ud, task, thread) once for every
+ * task in [0, ntasks), spread over the workers and the
+ * calling thread, and returns when all of them are done.
+ * thread is in [0, nthreads), with 0 being the caller, so
+ * it can be used to index per-thread scratch space.
+ *
+ * Each thread starts with an even, contiguous share of the
+ * tasks and takes them from the front. A thread that runs
+ * out steals single tasks from the back of the others, so
+ * uneven task costs still balance out.
+ *
+ * Jobs are serialized, and fn must not call sg_pool_run
+ * on the same pool.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+/*
+ * A thread's remaining tasks [lo, hi), packed as hi << 32 | lo
+ * so both ends can be claimed with one compare-and-swap.
+ * Padded out to its own cache line.
+ */
+
+typedef struct {
+    uint64_t range;
+    char pad[64 - sizeof(uint64_t)];
+} task_range;
+
+struct sg_pool {
+    int nthreads;
+    pthread_t *threads;
+    pthread_mutex_t run;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    unsigned long job;
+    int quit;
+    int active;
+
+    void (*fn)(void *, int, int);
+    void *ud;
+    task_range *ranges;
+};
+
+typedef struct {
+    sg_pool *p;
+    int id;
+
+    /* jobs posted before the thread was made */
+    unsigned long job;
+} worker_data;
+
+#define RANGE(lo, hi) ((uint64_t)(hi) << 32 | (uint32_t)(lo))
+#define RANGE_LO(r) ((int)((r) & 0xffffffff))
+#define RANGE_HI(r) ((int)((r) >> 32))
+
+/* takes the first task of the thread's own range */
+
+static int take(task_range *tr)
+{
+    uint64_t r;
+    int lo, hi;
+
+    while (1) {
+        r = __atomic_load_n(&tr->range, __ATOMIC_ACQUIRE);
+        lo = RANGE_LO(r);
+        hi = RANGE_HI(r);
+        if (lo >= hi) return -1;
+        if (__atomic_compare_exchange_n(&tr->range, &r, RANGE(lo + 1, hi), 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return lo;
+        }
+    }
+}
+
+/* takes the last task of another thread's range */
+
+static int steal(task_range *tr)
+{
+    uint64_t r;
+    int lo, hi;
+
+    while (1) {
+        r = __atomic_load_n(&tr->range, __ATOMIC_ACQUIRE);
+        lo = RANGE_LO(r);
+        hi = RANGE_HI(r);
+        if (lo >= hi) return -1;
+        if (__atomic_compare_exchange_n(&tr->range, &r, RANGE(lo, hi - 1), 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return hi - 1;
+        }
+    }
+}
+
+static void run_tasks(sg_pool *p, int thread)
+{
+    int task;
+    int i;
+
+    while ((task = take(&p->ranges[thread])) >= 0) {
+        p->fn(p->ud, task, thread);
+    }
+
+    /* ranges only shrink, so one empty pass means all done */
+    for (i = 1; i < p->nthreads; i++) {
+        int victim;
+
+        victim = (thread + i) % p->nthreads;
+
+        while ((task = steal(&p->ranges[victim])) >= 0) {
+            p->fn(p->ud, task, thread);
+            i = 0;
+        }
+    }
+}
+
+static void *worker(void *arg)
+{
+    worker_data *wd;
+    sg_pool *p;
+    unsigned long seen;
+
+    wd = arg;
+    p = wd->p;
+
+    /*
+     * taken when the thread was made: reading p->job here
+     * would skip a job posted before this thread first ran,
+     * and sg_pool_run would wait on it forever
+     */
+    seen = wd->job;
+
+    pthread_mutex_lock(&p->lock);
+
+    while (1) {
+        while (p->job == seen && !p->quit) {
+            pthread_cond_wait(&p->work, &p->lock);
+        }
+
+        if (p->quit) break;
+
+        seen = p->job;
+        pthread_mutex_unlock(&p->lock);
+
+        run_tasks(p, wd->id);
+
+        pthread_mutex_lock(&p->lock);
+        p->active--;
+        if (p->active == 0) pthread_cond_signal(&p->done);
+    }
+
+    pthread_mutex_unlock(&p->lock);
+    free(wd);
+
+    return NULL;
+}
+
+/* nthreads counts the calling thread, so nthreads - 1 are spawned */
+
+void sg_pool_new(sg_pool **pp, int nthreads)
+{
+    sg_pool *p;
+    int i;
+
+    if (nthreads < 1) nthreads = 1;
+
+    p = calloc(1, sizeof(sg_pool));
+    p->nthreads = nthreads;
+    p->threads = malloc(sizeof(pthread_t) * nthreads);
+    p->ranges = calloc(nthreads, sizeof(task_range));
+    p->job = 0;
+    p->quit = 0;
+    p->active = 0;
+
+    pthread_mutex_init(&p->run, NULL);
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->work, NULL);
+    pthread_cond_init(&p->done, NULL);
+
+    /* a thread that can't be made leaves the pool smaller */
+    for (i = 1; i < nthreads; i++) {
+        worker_data *wd;
+        wd = malloc(sizeof(worker_data));
+
+        if (wd == NULL) break;
+
+        wd->p = p;
+        wd->id = i;
+        wd->job = p->job;
+
+        if (pthread_create(&p->threads[i], NULL, worker, wd) != 0) {
+            free(wd);
+            break;
+        }
+    }
+
+    p->nthreads = i;
+
+    *pp = p;
+}
+
+void sg_pool_del(sg_pool **pp)
+{
+    sg_pool *p;
+    int i;
+
+    p = *pp;
+
+    if (p == NULL) return;
+
+    pthread_mutex_lock(&p->lock);
+    p->quit = 1;
+    pthread_cond_broadcast(&p->work);
+    pthread_mutex_unlock(&p->lock);
+
+    for (i = 1; i < p->nthreads; i++) {
+        pthread_join(p->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&p->done);
+    pthread_cond_destroy(&p->work);
+    pthread_mutex_destroy(&p->lock);
+    pthread_mutex_destroy(&p->run);
+    free(p->ranges);
+    free(p->threads);
+    free(p);
+    *pp = NULL;
+}
+
+int sg_pool_nthreads(sg_pool *p)
+{
+    return p->nthreads;
+}
+
+void sg_pool_run(sg_pool *p,
+                 int ntasks,
+                 void (*fn)(void *, int, int),
+                 void *ud)
+{
+    int n;
+    int t;
+
+    pthread_mutex_lock(&p->run);
+
+    p->fn = fn;
+    p->ud = ud;
+
+    n = p->nthreads;
+    for (t = 0; t < n; t++) {
+        p->ranges[t].range = RANGE((long)ntasks * t / n,
+                                   (long)ntasks * (t + 1) / n);
+    }
+
+    if (p->nthreads > 1 && ntasks > 1) {
+        pthread_mutex_lock(&p->lock);
+        p->active = p->nthreads - 1;
+        p->job++;
+        pthread_cond_broadcast(&p->work);
+        pthread_mutex_unlock(&p->lock);
+
+        run_tasks(p, 0);
+
+        pthread_mutex_lock(&p->lock);
+        while (p->active > 0) pthread_cond_wait(&p->done, &p->lock);
+        pthread_mutex_unlock(&p->lock);
+    } else {
+        run_tasks(p, 0);
+    }
+
+    pthread_mutex_unlock(&p->run);
+}
+
+int sg_pool_ncores(void)
+{
+    long n;
+
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n < 1) return 1;
+    return n;
+}
+
+/*
+ * The process-wide pool shared by the shaders. It is made
+ * on first use with one thread per core, is not owned by
+ * any video, and is freed at exit.
+ */
+
+static sg_pool *global = NULL;
+
+static void global_del(void)
+{
+    sg_pool_del(&global);
+}
+
+static void global_new(int nthreads)
+{
+    static int registered = 0;
+
+    if (!registered) {
+        atexit(global_del);
+        registered = 1;
+    }
+
+    sg_pool_new(&global, nthreads);
+}
+
+sg_pool * sg_pool_global(void)
+{
+    if (global == NULL) global_new(sg_pool_ncores());
+    return global;
+}
+
+/* 0 goes back to one thread per core */
+
+void sg_pool_global_resize(int nthreads)
+{
+    if (nthreads <= 0) nthreads = sg_pool_ncores();
+
+    if (global != NULL) {
+        if (global->nthreads == nthreads) return;
+        sg_pool_del(&global);
+    }
+
+    global_new(nthreads);
+}
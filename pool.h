@@ -0,0 +1,16 @@
+#ifndef SG_POOL_H
+#define SG_POOL_H
+typedef struct sg_pool sg_pool;
+
+void sg_pool_new(sg_pool **pp, int nthreads);
+void sg_pool_del(sg_pool **pp);
+int sg_pool_nthreads(sg_pool *p);
+void sg_pool_run(sg_pool *p,
+                 int ntasks,
+                 void (*fn)(void *, int, int),
+                 void *ud);
+
+int sg_pool_ncores(void);
+sg_pool * sg_pool_global(void);
+void sg_pool_global_resize(int nthreads);
+#endif
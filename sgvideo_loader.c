@@ -59,22 +59,78 @@ static int l_vg_del(lua_State *L)
     return 0;
 }
 
+/* same order as the SG_VIDEO_* colorspace enum */
+static const char *colorspaces[] = {"i444", "i420", "nv12", NULL};
+
 static int l_vg_open(lua_State *L)
 {
     sg_video *v;
     const char *filename;
     int w, h, fps;
+    int csp;
+    int threads;
+    int sliced;
 
     v = check_vg(L, 1);
     filename = luaL_checkstring(L, 2);
     w = luaL_checkinteger(L, 3);
     h = luaL_checkinteger(L, 4);
     fps = luaL_checkinteger(L, 5);
+    csp = luaL_checkoption(L, 6, "i444", colorspaces);
+    /* 0 threads lets x264 choose */
+    threads = luaL_optinteger(L, 7, 0);
+    sliced = lua_toboolean(L, 8);
 
+    sg_video_colorspace(v, csp);
+    sg_video_encoder_threads(v, threads, sliced);
     sg_video_open(v, filename, w, h, fps);
     return 0;
 }
 
+static int l_vg_pipeline(lua_State *L)
+{
+    sg_video *v;
+    int nframes;
+
+    v = check_vg(L, 1);
+    nframes = luaL_checkinteger(L, 2);
+
+    sg_video_pipeline(v, nframes);
+    return 0;
+}
+
+static int l_vg_lossless(lua_State *L)
+{
+    sg_video *v;
+
+    v = check_vg(L, 1);
+
+    sg_video_lossless(v, lua_toboolean(L, 2));
+    return 0;
+}
+
+static int l_vg_threads(lua_State *L)
+{
+    sg_video *v;
+    int nthreads;
+
+    v = check_vg(L, 1);
+    nthreads = luaL_checkinteger(L, 2);
+
+    sg_video_threads(v, nthreads);
+    return 0;
+}
+
+static int l_vg_linear(lua_State *L)
+{
+    sg_video *v;
+
+    v = check_vg(L, 1);
+
+    sg_video_linear(v, lua_toboolean(L, 2));
+    return 0;
+}
+
 static int l_vg_cairo_init(lua_State *L)
 {
     sg_video *v;
@@ -274,6 +330,45 @@ static int l_vg_img(lua_State *L)
     return 0;
 }
 
+static int l_vg_img_over(lua_State *L)
+{
+    sg_image *i;
+    sg_video *v;
+    float x, y;
+    float a;
+
+    v = check_vg(L, 1);
+    i = check_img(L, 2);
+    x = luaL_checknumber(L, 3);
+    y = luaL_checknumber(L, 4);
+    a = luaL_optnumber(L, 5, 1);
+
+    sg_video_image_over(v, i, x, y, a);
+    return 0;
+}
+
+static int l_vg_img_draw(lua_State *L)
+{
+    sg_image *i;
+    sg_video *v;
+    float x, y;
+    float sx, sy;
+    float angle;
+    float a;
+
+    v = check_vg(L, 1);
+    i = check_img(L, 2);
+    x = luaL_checknumber(L, 3);
+    y = luaL_checknumber(L, 4);
+    sx = luaL_optnumber(L, 5, 1);
+    sy = luaL_optnumber(L, 6, sx);
+    angle = luaL_optnumber(L, 7, 0);
+    a = luaL_optnumber(L, 8, 1);
+
+    sg_video_image_draw(v, i, x, y, sx, sy, angle, a);
+    return 0;
+}
+
 static int l_vg_img_stencil(lua_State *L)
 {
     sg_image *i;
@@ -308,6 +403,94 @@ static int l_vg_img_dims(lua_State *L)
     return 2;
 }
 
+static int l_vg_atlas_new(lua_State *L)
+{
+    sg_atlas *a;
+    int w, h;
+
+    w = luaL_checkinteger(L, 1);
+    h = luaL_checkinteger(L, 2);
+
+    if (w <= 0 || h <= 0) {
+        luaL_error(L, "atlas_new: invalid size %dx%d\n", w, h);
+    }
+
+    sg_atlas_new(&a, w, h);
+    lua_pushlightuserdata(L, a);
+    return 1;
+}
+
+static sg_atlas * check_atlas(lua_State *L, int index)
+{
+    sg_atlas *a;
+
+    a = lua_touserdata(L, index);
+
+    if (a == NULL) luaL_error(L, "Invalid sg_atlas argument.\n");
+
+    return a;
+}
+
+static int l_vg_atlas_del(lua_State *L)
+{
+    sg_atlas *a;
+    a = check_atlas(L, 1);
+    sg_atlas_del(&a);
+    return 0;
+}
+
+static int l_vg_atlas_add(lua_State *L)
+{
+    sg_atlas *a;
+    const char *filename;
+    int id;
+
+    a = check_atlas(L, 1);
+    filename = luaL_checkstring(L, 2);
+    id = sg_atlas_add(a, filename);
+
+    if (id < 0) {
+        luaL_error(L, "atlas_add failed.\n");
+    }
+
+    lua_pushinteger(L, id);
+    return 1;
+}
+
+static int l_vg_atlas_dims(lua_State *L)
+{
+    sg_atlas *a;
+    int id;
+    int w, h;
+
+    a = check_atlas(L, 1);
+    id = luaL_checkinteger(L, 2);
+    w = h = 0;
+    sg_atlas_dims(a, id, &w, &h);
+    lua_pushinteger(L, w);
+    lua_pushinteger(L, h);
+    return 2;
+}
+
+static int l_vg_atlas_blit(lua_State *L)
+{
+    sg_video *v;
+    sg_atlas *a;
+    int id;
+    float x, y;
+    float alpha;
+
+    v = check_vg(L, 1);
+    a = check_atlas(L, 2);
+    id = luaL_checkinteger(L, 3);
+    x = luaL_checknumber(L, 4);
+    y = luaL_checknumber(L, 5);
+    alpha = luaL_optnumber(L, 6, 1);
+
+    sg_video_atlas(v, a, id, x, y, alpha);
+    return 0;
+}
+
 static int l_vg_scale(lua_State *L)
 {
     sg_video *v;
@@ -551,6 +734,70 @@ static int l_vg_text_draw(lua_State *L)
     return 1;
 }
 
+static int l_vg_text_cache(lua_State *L)
+{
+    sg_video *v;
+    lua_Integer bytes;
+
+    v = check_vg(L, 1);
+    bytes = luaL_checkinteger(L, 2);
+    if (bytes < 0) bytes = 0;
+
+    sg_video_text_cache(v, bytes);
+    return 0;
+}
+
+static int l_vg_text_atlas(lua_State *L)
+{
+    sg_video *v;
+    int w, h, max;
+
+    v = check_vg(L, 1);
+    w = luaL_checkinteger(L, 2);
+    h = luaL_checkinteger(L, 3);
+    max = luaL_optinteger(L, 4, SG_TEXT_ATLAS_MAX);
+
+    sg_video_text_atlas(v, w, h, max);
+    return 0;
+}
+
+static int l_vg_text_atlas_stats(lua_State *L)
+{
+    sg_video *v;
+    sg_text_atlas_stats s;
+
+    v = check_vg(L, 1);
+    sg_video_text_atlas_stats(v, &s);
+
+    lua_newtable(L);
+    pushval(L, "width", s.w);
+    pushval(L, "height", s.h);
+    pushval(L, "hits", s.hits);
+    pushval(L, "misses", s.misses);
+    pushval(L, "rasterizations", s.rasters);
+    pushval(L, "grows", s.grows);
+    pushval(L, "resets", s.resets);
+
+    return 1;
+}
+
+static int l_vg_text_cache_stats(lua_State *L)
+{
+    sg_video *v;
+    long hits, misses;
+    size_t size;
+
+    v = check_vg(L, 1);
+    sg_video_text_cache_stats(v, &hits, &misses, &size);
+
+    lua_newtable(L);
+    pushval(L, "hits", hits);
+    pushval(L, "misses", misses);
+    pushval(L, "bytes", size);
+
+    return 1;
+}
+
 static int l_vg_text_setfont(lua_State *L)
 {
     sg_video *v;
@@ -681,6 +928,33 @@ static int l_vg_roundtri(lua_State *L)
     return 0;
 }
 
+static int l_vg_fbm_field_new(lua_State *L)
+{
+    sg_fbm_field *f;
+    sg_fbm_field_new(&f);
+    lua_pushlightuserdata(L, f);
+    return 1;
+}
+
+static sg_fbm_field * check_fbm_field(lua_State *L, int index)
+{
+    sg_fbm_field *f;
+
+    f = lua_touserdata(L, index);
+
+    if (f == NULL) luaL_error(L, "Invalid sg_fbm_field argument.\n");
+
+    return f;
+}
+
+static int l_vg_fbm_field_del(lua_State *L)
+{
+    sg_fbm_field *f;
+    f = check_fbm_field(L, 1);
+    sg_fbm_field_del(&f);
+    return 0;
+}
+
 static int l_vg_fbmfill(lua_State *L)
 {
     sg_video *v;
@@ -695,16 +969,39 @@ static int l_vg_fbmfill(lua_State *L)
     oct = luaL_checkinteger(L, 5);
     t = luaL_checknumber(L, 6);
 
-    sg_video_fbm(v, r, g, b, oct, t);
+    if (lua_isnoneornil(L, 7)) {
+        sg_video_fbm(v, r, g, b, oct, t);
+    } else {
+        sg_video_fbm_field(v, r, g, b, oct, t, check_fbm_field(L, 7));
+    }
+
+    return 0;
+}
+
+static int l_vg_fbm_quality(lua_State *L)
+{
+    sg_video *v;
+    int div;
+
+    v = check_vg(L, 1);
+    div = luaL_checkinteger(L, 2);
+
+    sg_video_fbm_quality(v, div);
     return 0;
 }
 
+/* same order as the SG_UNSHADE_* layout enum */
+static const char *unshade_layouts[] = {"packed", "planar", NULL};
+
 static int l_vg_unshade_init(lua_State *L)
 {
     sg_video *v;
+    int layout;
 
     v = check_vg(L, 1);
+    layout = luaL_checkoption(L, 2, "packed", unshade_layouts);
 
+    sg_video_unshade_layout(v, layout);
     sg_video_unshade_init(v);
     return 0;
 }
@@ -733,8 +1030,41 @@ static int l_vg_unshade_transfer(lua_State *L)
     return 0;
 }
 
+static int l_vg_unshade_dither(lua_State *L)
+{
+    sg_video *v;
+
+    v = check_vg(L, 1);
+
+    sg_video_unshade_dither(v, lua_toboolean(L, 2));
+    return 0;
+}
+
+static int l_vg_unshade_append(lua_State *L)
+{
+    sg_video *v;
+
+    v = check_vg(L, 1);
+
+    sg_video_unshade_append(v);
+    return 0;
+}
+
 void sg_video_startest(sg_video *v);
 
+static int l_vg_unshade_tile(lua_State *L)
+{
+    sg_video *v;
+    int w, h;
+
+    v = check_vg(L, 1);
+    w = luaL_checkinteger(L, 2);
+    h = luaL_checkinteger(L, 3);
+
+    sg_video_unshade_tile(v, w, h);
+    return 0;
+}
+
 static int l_vg_unshade_test(lua_State *L)
 {
     sg_video *v;
@@ -796,6 +1126,10 @@ static const luaL_Reg vglib[] = {
     {"new", l_vg_new},
     {"del", l_vg_del},
     {"open", l_vg_open},
+    {"pipeline", l_vg_pipeline},
+    {"threads", l_vg_threads},
+    {"lossless", l_vg_lossless},
+    {"linear", l_vg_linear},
     {"cairo_init", l_vg_cairo_init},
     {"fontstash_init", l_vg_fontstash_init},
     {"close", l_vg_close},
@@ -813,6 +1147,13 @@ static const luaL_Reg vglib[] = {
     {"img_dims", l_vg_img_dims},
     {"img_stencil", l_vg_img_stencil},
     {"img", l_vg_img},
+    {"img_over", l_vg_img_over},
+    {"img_draw", l_vg_img_draw},
+    {"atlas_new", l_vg_atlas_new},
+    {"atlas_del", l_vg_atlas_del},
+    {"atlas_add", l_vg_atlas_add},
+    {"atlas_dims", l_vg_atlas_dims},
+    {"atlas_blit", l_vg_atlas_blit},
     {"scale", l_vg_scale},
     {"rect", l_vg_rect},
     {"arc", l_vg_arc},
@@ -830,6 +1171,9 @@ static const luaL_Reg vglib[] = {
     {"roundrect", l_vg_roundrect},
     {"roundtri", l_vg_roundtri},
     {"fbmfill", l_vg_fbmfill},
+    {"fbm_quality", l_vg_fbm_quality},
+    {"fbm_field_new", l_vg_fbm_field_new},
+    {"fbm_field_del", l_vg_fbm_field_del},
     {"star", l_vg_star},
 
     /* text/fontstash stuff */
@@ -842,6 +1186,10 @@ static const luaL_Reg vglib[] = {
     {"text_vertmetrics", l_vg_text_vertmetrics},
     {"text_setblur", l_vg_text_setblur},
     {"text_draw", l_vg_text_draw},
+    {"text_cache", l_vg_text_cache},
+    {"text_cache_stats", l_vg_text_cache_stats},
+    {"text_atlas", l_vg_text_atlas},
+    {"text_atlas_stats", l_vg_text_atlas_stats},
     {"text_setfont", l_vg_text_setfont},
 
 
@@ -849,6 +1197,9 @@ static const luaL_Reg vglib[] = {
     {"unshade_init", l_vg_unshade_init},
     {"unshade_clear", l_vg_unshade_clear},
     {"unshade_transfer", l_vg_unshade_transfer},
+    {"unshade_dither", l_vg_unshade_dither},
+    {"unshade_append", l_vg_unshade_append},
+    {"unshade_tile", l_vg_unshade_tile},
     {"unshade_test", l_vg_unshade_test},
     {"unshade_fill", l_vg_unshade_fill},
 
@@ -10,6 +10,11 @@
  */
 #include <stdint.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SG_SIMPLEX_X86
+#include <immintrin.h>
+#endif
+
 /**
  * Permutation table. This is just a random jumble of all numbers 0-255.
  *
@@ -30,9 +35,12 @@
  * This array is accessed a *lot* by the noise functions.
  * A vector-valued noise over 3D accesses it 96 times, and a
  * float-valued 4D noise 64 times. We want this to fit in the cache!
+ *
+ * Three bytes of padding let the AVX2 path gather 32 bits at
+ * any index and mask off the entry.
  */
 
-static const uint8_t perm[256] = {
+static const uint8_t perm[256 + 3] = {
     151, 160, 137, 91, 90, 15,
     131, 13, 201, 95, 96, 53, 194, 233, 7, 225, 140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23,
     190, 6, 148, 247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32, 57, 177, 33,
@@ -142,3 +150,262 @@ float sg_simplex(float x, float y)
     // The result is scaled to return values in the interval [-1,1].
     return 45.23065f * (n0 + n1 + n2);
 }
+
+/*
+ * Batched simplex noise: out[k] = sg_simplex(x[k], y[k]) for
+ * n points, bit for bit. The SIMD paths pick the corners with
+ * masks instead of branches and do the same float operations
+ * in the same order as the scalar code above.
+ */
+
+static void simplex_n_c(const float *x, const float *y, float *out, int n)
+{
+    int k;
+    for (k = 0; k < n; k++) out[k] = sg_simplex(x[k], y[k]);
+}
+
+#ifdef SG_SIMPLEX_X86
+
+/* grad() on four lanes */
+
+__attribute__((target("sse2")))
+static __m128 grad_sse2(__m128i h, __m128 x, __m128 y)
+{
+    __m128 lt4, u, v;
+    __m128i su, sv;
+
+    h = _mm_and_si128(h, _mm_set1_epi32(0x3F));
+    lt4 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+    u = _mm_or_ps(_mm_and_ps(lt4, x), _mm_andnot_ps(lt4, y));
+    v = _mm_or_ps(_mm_and_ps(lt4, y), _mm_andnot_ps(lt4, x));
+    v = _mm_mul_ps(v, _mm_set1_ps(2.0f));
+
+    /* negate by flipping the sign bit */
+    su = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31);
+    sv = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30);
+    u = _mm_xor_ps(u, _mm_castsi128_ps(su));
+    v = _mm_xor_ps(v, _mm_castsi128_ps(sv));
+
+    return _mm_add_ps(u, v);
+}
+
+/* one corner's contribution on four lanes */
+
+__attribute__((target("sse2")))
+static __m128 corner_sse2(__m128i h, __m128 x, __m128 y)
+{
+    __m128 t;
+    __m128 n;
+
+    t = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(x, x)),
+                   _mm_mul_ps(y, y));
+    n = _mm_mul_ps(t, t);
+    n = _mm_mul_ps(_mm_mul_ps(n, n), grad_sse2(h, x, y));
+
+    return _mm_andnot_ps(_mm_cmplt_ps(t, _mm_setzero_ps()), n);
+}
+
+/* perm[(uint8_t)(a + perm[(uint8_t)b])], lane by lane */
+
+__attribute__((target("sse2")))
+static __m128i hash2_sse2(__m128i a, __m128i b)
+{
+    int32_t ia[4], ib[4];
+    int k;
+
+    _mm_storeu_si128((__m128i *)ia, a);
+    _mm_storeu_si128((__m128i *)ib, b);
+
+    for (k = 0; k < 4; k++) {
+        ia[k] = hash(ia[k] + hash(ib[k]));
+    }
+
+    return _mm_loadu_si128((const __m128i *)ia);
+}
+
+__attribute__((target("sse2")))
+static __m128 simplex4_sse2(__m128 x, __m128 y)
+{
+    const __m128 F2 = _mm_set1_ps(0.366025403f);
+    const __m128 G2 = _mm_set1_ps(0.211324865f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128i ione = _mm_set1_epi32(1);
+    __m128 s, xs, ys;
+    __m128i i, j;
+    __m128 t, x0, y0, x1, y1, x2, y2;
+    __m128 m;
+    __m128i i1, j1;
+    __m128 n;
+
+    s = _mm_mul_ps(_mm_add_ps(x, y), F2);
+    xs = _mm_add_ps(x, s);
+    ys = _mm_add_ps(y, s);
+
+    /* fastfloor: truncate, then step down where that rounded up */
+    i = _mm_cvttps_epi32(xs);
+    j = _mm_cvttps_epi32(ys);
+    i = _mm_add_epi32(i, _mm_castps_si128(_mm_cmplt_ps(xs, _mm_cvtepi32_ps(i))));
+    j = _mm_add_epi32(j, _mm_castps_si128(_mm_cmplt_ps(ys, _mm_cvtepi32_ps(j))));
+
+    t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(i, j)), G2);
+    x0 = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+    y0 = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+
+    /* lower triangle where x0 > y0 */
+    m = _mm_cmpgt_ps(x0, y0);
+    i1 = _mm_and_si128(_mm_castps_si128(m), ione);
+    j1 = _mm_sub_epi32(ione, i1);
+
+    x1 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(m, one)), G2);
+    y1 = _mm_add_ps(_mm_sub_ps(y0, _mm_andnot_ps(m, one)), G2);
+    x2 = _mm_add_ps(_mm_sub_ps(x0, one), _mm_set1_ps(2.0f * 0.211324865f));
+    y2 = _mm_add_ps(_mm_sub_ps(y0, one), _mm_set1_ps(2.0f * 0.211324865f));
+
+    n = corner_sse2(hash2_sse2(i, j), x0, y0);
+    n = _mm_add_ps(n, corner_sse2(hash2_sse2(_mm_add_epi32(i, i1),
+                                             _mm_add_epi32(j, j1)),
+                                  x1, y1));
+    n = _mm_add_ps(n, corner_sse2(hash2_sse2(_mm_add_epi32(i, ione),
+                                             _mm_add_epi32(j, ione)),
+                                  x2, y2));
+
+    return _mm_mul_ps(_mm_set1_ps(45.23065f), n);
+}
+
+__attribute__((target("sse2")))
+static void simplex_n_sse2(const float *x, const float *y, float *out, int n)
+{
+    int k;
+
+    for (k = 0; k + 4 <= n; k += 4) {
+        _mm_storeu_ps(out + k,
+                      simplex4_sse2(_mm_loadu_ps(x + k), _mm_loadu_ps(y + k)));
+    }
+
+    simplex_n_c(x + k, y + k, out + k, n - k);
+}
+
+__attribute__((target("avx2")))
+static __m256 grad_avx2(__m256i h, __m256 x, __m256 y)
+{
+    __m256 lt4, u, v;
+    __m256i su, sv;
+
+    h = _mm256_and_si256(h, _mm256_set1_epi32(0x3F));
+    lt4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    u = _mm256_blendv_ps(y, x, lt4);
+    v = _mm256_blendv_ps(x, y, lt4);
+    v = _mm256_mul_ps(v, _mm256_set1_ps(2.0f));
+
+    su = _mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31);
+    sv = _mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30);
+    u = _mm256_xor_ps(u, _mm256_castsi256_ps(su));
+    v = _mm256_xor_ps(v, _mm256_castsi256_ps(sv));
+
+    return _mm256_add_ps(u, v);
+}
+
+__attribute__((target("avx2")))
+static __m256 corner_avx2(__m256i h, __m256 x, __m256 y)
+{
+    __m256 t;
+    __m256 n;
+
+    t = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(x, x)),
+                      _mm256_mul_ps(y, y));
+    n = _mm256_mul_ps(t, t);
+    n = _mm256_mul_ps(_mm256_mul_ps(n, n), grad_avx2(h, x, y));
+
+    return _mm256_andnot_ps(_mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_LT_OQ), n);
+}
+
+__attribute__((target("avx2")))
+static __m256i hash_avx2(__m256i i)
+{
+    const __m256i lo = _mm256_set1_epi32(0xff);
+    i = _mm256_i32gather_epi32((const int *)perm, _mm256_and_si256(i, lo), 1);
+    return _mm256_and_si256(i, lo);
+}
+
+__attribute__((target("avx2")))
+static __m256i hash2_avx2(__m256i a, __m256i b)
+{
+    return hash_avx2(_mm256_add_epi32(a, hash_avx2(b)));
+}
+
+__attribute__((target("avx2")))
+static __m256 simplex8_avx2(__m256 x, __m256 y)
+{
+    const __m256 F2 = _mm256_set1_ps(0.366025403f);
+    const __m256 G2 = _mm256_set1_ps(0.211324865f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256i ione = _mm256_set1_epi32(1);
+    __m256 s, xs, ys;
+    __m256i i, j;
+    __m256 t, x0, y0, x1, y1, x2, y2;
+    __m256 m;
+    __m256i i1, j1;
+    __m256 n;
+
+    s = _mm256_mul_ps(_mm256_add_ps(x, y), F2);
+    xs = _mm256_add_ps(x, s);
+    ys = _mm256_add_ps(y, s);
+
+    i = _mm256_cvttps_epi32(_mm256_floor_ps(xs));
+    j = _mm256_cvttps_epi32(_mm256_floor_ps(ys));
+
+    t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(i, j)), G2);
+    x0 = _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t));
+    y0 = _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t));
+
+    m = _mm256_cmp_ps(x0, y0, _CMP_GT_OQ);
+    i1 = _mm256_and_si256(_mm256_castps_si256(m), ione);
+    j1 = _mm256_sub_epi32(ione, i1);
+
+    x1 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_and_ps(m, one)), G2);
+    y1 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_andnot_ps(m, one)), G2);
+    x2 = _mm256_add_ps(_mm256_sub_ps(x0, one), _mm256_set1_ps(2.0f * 0.211324865f));
+    y2 = _mm256_add_ps(_mm256_sub_ps(y0, one), _mm256_set1_ps(2.0f * 0.211324865f));
+
+    n = corner_avx2(hash2_avx2(i, j), x0, y0);
+    n = _mm256_add_ps(n, corner_avx2(hash2_avx2(_mm256_add_epi32(i, i1),
+                                                _mm256_add_epi32(j, j1)),
+                                     x1, y1));
+    n = _mm256_add_ps(n, corner_avx2(hash2_avx2(_mm256_add_epi32(i, ione),
+                                                _mm256_add_epi32(j, ione)),
+                                     x2, y2));
+
+    return _mm256_mul_ps(_mm256_set1_ps(45.23065f), n);
+}
+
+__attribute__((target("avx2")))
+static void simplex_n_avx2(const float *x, const float *y, float *out, int n)
+{
+    int k;
+
+    for (k = 0; k + 8 <= n; k += 8) {
+        _mm256_storeu_ps(out + k,
+                         simplex8_avx2(_mm256_loadu_ps(x + k),
+                                       _mm256_loadu_ps(y + k)));
+    }
+
+    simplex_n_sse2(x + k, y + k, out + k, n - k);
+}
+#endif
+
+void sg_simplex_n(const float *x, const float *y, float *out, int n)
+{
+#ifdef SG_SIMPLEX_X86
+    if (__builtin_cpu_supports("avx2")) {
+        simplex_n_avx2(x, y, out, n);
+        return;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        simplex_n_sse2(x, y, out, n);
+        return;
+    }
+#endif
+
+    simplex_n_c(x, y, out, n);
+}
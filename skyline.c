@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2021 Muvik Labs, LLC
+ * Distributed under the MIT license.
+ */
+
+/*
+ * Skyline rectangle packer, after the one fontstash uses for
+ * its glyph atlas: the top edge of the packed area is kept as
+ * a list of horizontal segments, and each new rectangle is
+ * dropped where it lands lowest (bottom left fit).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "skyline.h"
+
+typedef struct {
+    int x, y, w;
+} skyline_node;
+
+struct sg_skyline {
+    int w, h;
+    skyline_node *nodes;
+    int nnodes;
+    int cnodes;
+};
+
+void sg_skyline_new(sg_skyline **psky, int w, int h)
+{
+    sg_skyline *sky;
+
+    sky = calloc(1, sizeof(sg_skyline));
+    sky->w = w;
+    sky->h = h;
+    sky->cnodes = 16;
+    sky->nodes = malloc(sizeof(skyline_node) * sky->cnodes);
+
+    sky->nodes[0].x = 0;
+    sky->nodes[0].y = 0;
+    sky->nodes[0].w = w;
+    sky->nnodes = 1;
+
+    *psky = sky;
+}
+
+void sg_skyline_del(sg_skyline **psky)
+{
+    sg_skyline *sky;
+
+    if (*psky == NULL) return;
+
+    sky = *psky;
+    free(sky->nodes);
+    free(sky);
+    *psky = NULL;
+}
+
+static void insert_node(sg_skyline *sky, int idx, int x, int y, int w)
+{
+    if (sky->nnodes + 1 > sky->cnodes) {
+        sky->cnodes *= 2;
+        sky->nodes = realloc(sky->nodes, sizeof(skyline_node) * sky->cnodes);
+    }
+
+    memmove(&sky->nodes[idx + 1],
+            &sky->nodes[idx],
+            sizeof(skyline_node) * (sky->nnodes - idx));
+
+    sky->nodes[idx].x = x;
+    sky->nodes[idx].y = y;
+    sky->nodes[idx].w = w;
+    sky->nnodes++;
+}
+
+static void remove_node(sg_skyline *sky, int idx)
+{
+    memmove(&sky->nodes[idx],
+            &sky->nodes[idx + 1],
+            sizeof(skyline_node) * (sky->nnodes - idx - 1));
+    sky->nnodes--;
+}
+
+/*
+ * Height a w by h rectangle would rest at if placed at
+ * segment i, or -1 if it does not fit there.
+ */
+
+static int rect_fits(sg_skyline *sky, int i, int w, int h)
+{
+    int y;
+    int left;
+
+    if (sky->nodes[i].x + w > sky->w) return -1;
+
+    y = sky->nodes[i].y;
+    left = w;
+
+    while (left > 0) {
+        if (i == sky->nnodes) return -1;
+        if (sky->nodes[i].y > y) y = sky->nodes[i].y;
+        if (y + h > sky->h) return -1;
+        left -= sky->nodes[i].w;
+        i++;
+    }
+
+    return y;
+}
+
+static void add_level(sg_skyline *sky, int idx, int x, int y, int w, int h)
+{
+    int i;
+
+    insert_node(sky, idx, x, y + h, w);
+
+    /* trim the segments now under the new one */
+    for (i = idx + 1; i < sky->nnodes; i++) {
+        int shrink;
+        skyline_node *prev;
+
+        prev = &sky->nodes[i - 1];
+        if (sky->nodes[i].x >= prev->x + prev->w) break;
+
+        shrink = prev->x + prev->w - sky->nodes[i].x;
+        sky->nodes[i].x += shrink;
+        sky->nodes[i].w -= shrink;
+
+        if (sky->nodes[i].w > 0) break;
+
+        remove_node(sky, i);
+        i--;
+    }
+
+    /* merge neighbors of the same height */
+    for (i = 0; i < sky->nnodes - 1; i++) {
+        if (sky->nodes[i].y == sky->nodes[i + 1].y) {
+            sky->nodes[i].w += sky->nodes[i + 1].w;
+            remove_node(sky, i + 1);
+            i--;
+        }
+    }
+}
+
+/*
+ * Finds room for a rw by rh rectangle, writing its position
+ * to rx and ry. Returns 0 if it does not fit.
+ */
+
+int sg_skyline_add(sg_skyline *sky, int rw, int rh, int *rx, int *ry)
+{
+    int besth, bestw, besti;
+    int bestx, besty;
+    int i;
+
+    if (rw <= 0 || rh <= 0) return 0;
+
+    besth = sky->h + 1;
+    bestw = sky->w;
+    besti = -1;
+    bestx = besty = -1;
+
+    for (i = 0; i < sky->nnodes; i++) {
+        int y;
+
+        y = rect_fits(sky, i, rw, rh);
+        if (y < 0) continue;
+
+        if (y + rh < besth ||
+            (y + rh == besth && sky->nodes[i].w < bestw)) {
+            besti = i;
+            bestw = sky->nodes[i].w;
+            besth = y + rh;
+            bestx = sky->nodes[i].x;
+            besty = y;
+        }
+    }
+
+    if (besti < 0) return 0;
+
+    add_level(sky, besti, bestx, besty, rw, rh);
+
+    *rx = bestx;
+    *ry = besty;
+
+    return 1;
+}
@@ -0,0 +1,7 @@
+#ifndef SG_SKYLINE_H
+#define SG_SKYLINE_H
+typedef struct sg_skyline sg_skyline;
+void sg_skyline_new(sg_skyline **psky, int w, int h);
+void sg_skyline_del(sg_skyline **psky);
+int sg_skyline_add(sg_skyline *sky, int rw, int rh, int *rx, int *ry);
+#endif
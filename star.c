@@ -19,66 +19,112 @@ typedef struct {
     int count;
 } star_stuff;
 
-static void draw(vec3 *fragColor, vec2 fragCoord, us_image_data *id)
+/*
+ * Span version of the star shader. The per-star terms are
+ * worked out once per span, and the inner loops run over
+ * plain float arrays.
+ */
+
+static void draw(float *red, float *green, float *blue,
+                 int n, vec2 pos, us_image_data *id)
 {
-    vec3 c;
+    float uvx[US_SPAN];
+    float uvy[US_SPAN];
+    float d[US_SPAN];
+    float len[US_SPAN];
+    float f[US_SPAN];
     float t;
-    float f;
     float phase;
     float dir;
-    float a;
-    float len;
-    float d;
-    int i;
-    vec2 uv;
-    vec2 uv_n;
+    float hx, resy;
+    int i, k;
     star_stuff *ss;
 
     ss = id->ud;
 
     t = id->iTime * 6.28f * 0.04f;
 
-    fragCoord = sub2(fragCoord, mul2s(id->iResolution, 0.5));
+    hx = id->iResolution.x * 0.5f;
+    resy = id->iResolution.y;
+
+    for (k = 0; k < n; k++) {
+        float ux, uy;
+        float l;
 
-    c = mkvec3(0.f, 0.f, 0.25f);
+        ux = ((pos.x + k) - hx) / resy;
+        uy = (pos.y - resy * 0.5f) / resy;
+        ux *= 15.f;
+        uy *= 15.f;
 
-    uv = div2(fragCoord, mkvec2(id->iResolution.y, id->iResolution.y));
-    uv = mul2s(uv, 15.f);
-    uv_n = normalize2(uv);
+        l = sqrt(ux*ux + uy*uy);
 
-    d = length2(uv) * (0.5 + 1. * (1 - ss->radius));
+        if (l == 0) {
+            uvx[k] = 0;
+            uvy[k] = 0;
+        } else {
+            uvx[k] = ux / l;
+            uvy[k] = uy / l;
+        }
 
-    f = 0.;
+        d[k] = l * (0.5 + 1. * (1 - ss->radius));
+        len[k] = -d[k]*(0.4f*ss->radius);
+        f[k] = 0.;
+    }
 
     phase = t;
     dir = 1.;
-    a = 0.;
-    len = -d*(0.4f*ss->radius);
 
     for (i = 0; i < ss->count; i++) {
-        float p;
-        p = phase +(sinf(i+t)-1.)*.05+len;
-        a = dot(uv_n,
-                normalize2(mkvec2(cosf((p)*dir), sinf((p)*dir))));
-        a = max(0.f, a);
-        a = powf(a, 10.f);
+        double off;
+
+        off = phase +(sinf(i+t)-1.)*.05;
+
+        for (k = 0; k < n; k++) {
+            float p;
+            float cx, sy;
+            float l;
+            float a;
+
+            p = off + len[k];
+            cx = cosf(p*dir);
+            sy = sinf(p*dir);
+            l = sqrt(cx*cx + sy*sy);
+
+            if (l == 0) {
+                a = 0;
+            } else {
+                a = uvx[k]*(cx / l) + uvy[k]*(sy / l);
+            }
+
+            a = 0.f > a ? 0.f : a;
+            a = powf(a, 10.f);
+            f[k] += a;
+            f[k] = fabsf(fmodf(f[k] + 1.f, 2.f)-1.f);
+        }
+
         dir *= -1;
         phase += fmodf((float)i, 6.28f);
-        f += a;
-        f = fabsf(fmodf(f + 1.f, 2.f)-1.f);
     }
 
-    f+=1.7-d*(.7+sinf(t+dot(uv_n, mkvec2(1.f, 0.f))*11.f)*(.02f + (1.f - ss->radius)*0.2f));
-    f = max(f, 0.f);
-    c = mix3(ss->bg, ss->color, f);
-    c = sub3sv(1.f,
-               mul3(mul3s(ss->tint, 3.f),
-               sub3sv(1.0, c))
-        );
+    for (k = 0; k < n; k++) {
+        vec3 c;
+        float fk;
+
+        fk = f[k];
+        fk+=1.7-d[k]*(.7+sinf(t+uvx[k]*11.f)*(.02f + (1.f - ss->radius)*0.2f));
+        fk = max(fk, 0.f);
+        c = mix3(ss->bg, ss->color, fk);
+        c = sub3sv(1.f,
+                   mul3(mul3s(ss->tint, 3.f),
+                   sub3sv(1.0, c))
+            );
 
-    c = min3(max3(c, 0.f), 1.f);
+        c = min3(max3(c, 0.f), 1.f);
 
-    *fragColor = c;
+        red[k] = c.x;
+        green[k] = c.y;
+        blue[k] = c.z;
+    }
 }
 
 void sg_video_star(sg_video *v,
@@ -88,15 +134,7 @@ void sg_video_star(sg_video *v,
                    float radius,
                    int count)
 {
-    int w, h;
-    int fps;
-    int frame;
     star_stuff ss;
-    vec3 *buf;
-
-    sg_video_dims(v, &w, &h);
-
-    buf = sg_video_unshadebuf(v);
 
     ss.color = color;
     ss.bg = bg;
@@ -104,9 +142,7 @@ void sg_video_star(sg_video *v,
     ss.radius = radius;
     ss.count = count;
 
-    fps = sg_video_fps(v);
-    frame = sg_video_framepos(v);
-    us_draw(buf, mkvec2(w, h), frame, fps, draw, &ss);
+    sg_video_unshade_span(v, draw, &ss);
 }
 
 static vec3 rgb(int r, int g, int b)
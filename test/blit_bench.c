@@ -0,0 +1,301 @@
+/*
+ * Times "over" compositing of a premultiplied 1080p image,
+ * then bilinear sampling of it rotated and scaled: the scalar
+ * code each started as, and sg_blit_over and sg_blit_sample
+ * as they run on this CPU. The results must match bit for
+ * bit.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../blit.h"
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define NFRAMES 20
+
+static uint32_t src[WIDTH * HEIGHT];
+static uint32_t base[WIDTH * HEIGHT];
+static uint32_t want[WIDTH * HEIGHT];
+static uint32_t got[WIDTH * HEIGHT];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t mul255(uint32_t a, uint32_t b)
+{
+    uint32_t t;
+    t = a * b + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+/* the scalar blit, as in blit.c */
+
+static void over_ref(uint32_t *dst, const uint32_t *s, int n, int opacity)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint32_t p, d, a, ia;
+
+        p = s[i];
+
+        if (opacity < 255) {
+            p = mul255(p >> 24, opacity) << 24 |
+                mul255((p >> 16) & 0xff, opacity) << 16 |
+                mul255((p >> 8) & 0xff, opacity) << 8 |
+                mul255(p & 0xff, opacity);
+        }
+
+        a = p >> 24;
+
+        if (a == 255) {
+            dst[i] = p;
+            continue;
+        }
+
+        if (a == 0 && (p & 0xffffff) == 0) continue;
+
+        d = dst[i];
+        ia = 255 - a;
+
+        dst[i] = 0xff000000 |
+            (((p >> 16) & 0xff) + mul255((d >> 16) & 0xff, ia)) << 16 |
+            (((p >> 8) & 0xff) + mul255((d >> 8) & 0xff, ia)) << 8 |
+            ((p & 0xff) + mul255(d & 0xff, ia));
+    }
+}
+
+/* the scalar sampler, as in blit.c */
+
+static int texels(const uint32_t *p, int w, int h, int x, int y, uint32_t *t)
+{
+    if (x < -1 || x >= w || y < -1 || y >= h) return 0;
+
+    t[0] = (x >= 0 && y >= 0) ? p[y * w + x] : 0;
+    t[1] = (x < w - 1 && y >= 0) ? p[y * w + x + 1] : 0;
+    t[2] = (x >= 0 && y < h - 1) ? p[(y + 1) * w + x] : 0;
+    t[3] = (x < w - 1 && y < h - 1) ? p[(y + 1) * w + x + 1] : 0;
+
+    return 1;
+}
+
+static void sample_ref(uint32_t *dst,
+                       const uint32_t *p, int w, int h,
+                       int32_t u, int32_t v,
+                       int32_t du, int32_t dv,
+                       int n)
+{
+    int i, sh;
+
+    for (i = 0; i < n; i++) {
+        uint32_t t[4];
+        int32_t ui, vi;
+        int fx, fy;
+
+        ui = u + i * du;
+        vi = v + i * dv;
+
+        dst[i] = 0;
+        if (!texels(p, w, h, ui >> 16, vi >> 16, t)) continue;
+
+        fx = (ui >> 8) & 0xff;
+        fy = (vi >> 8) & 0xff;
+
+        for (sh = 0; sh < 32; sh += 8) {
+            uint32_t a, b;
+            a = (((t[0] >> sh) & 0xff) * (256 - fy) +
+                 ((t[2] >> sh) & 0xff) * fy) >> 8;
+            b = (((t[1] >> sh) & 0xff) * (256 - fy) +
+                 ((t[3] >> sh) & 0xff) * fy) >> 8;
+            dst[i] |= ((a * (256 - fx) + b * fx) >> 8) << sh;
+        }
+    }
+}
+
+/*
+ * The frame sampled from the image turned by about 20 degrees
+ * and scaled about its center, each row clipped to the samples
+ * that touch the image, as sg_video_image_draw does.
+ */
+
+#define ANGLE 0.35
+
+static int spans[HEIGHT][2];
+
+static void line(double scale, int y,
+                 int32_t *u, int32_t *v, int32_t *du, int32_t *dv)
+{
+    double c, s;
+
+    c = cos(ANGLE) / scale;
+    s = sin(ANGLE) / scale;
+
+    *du = c * 65536;
+    *dv = -s * 65536;
+    *u = (WIDTH / 2 - WIDTH / 2 * c + (y - HEIGHT / 2) * s) * 65536;
+    *v = (HEIGHT / 2 + WIDTH / 2 * s + (y - HEIGHT / 2) * c) * 65536;
+}
+
+static void clip(double scale)
+{
+    int x, y;
+
+    for (y = 0; y < HEIGHT; y++) {
+        int32_t u, v, du, dv;
+
+        line(scale, y, &u, &v, &du, &dv);
+        spans[y][0] = WIDTH;
+        spans[y][1] = 0;
+
+        for (x = 0; x < WIDTH; x++) {
+            int tx, ty;
+
+            tx = (u + x * du) >> 16;
+            ty = (v + x * dv) >> 16;
+            if (tx < -1 || tx >= WIDTH || ty < -1 || ty >= HEIGHT) continue;
+            if (x < spans[y][0]) spans[y][0] = x;
+            spans[y][1] = x + 1;
+        }
+    }
+}
+
+static double bench_sample(void (*fn)(uint32_t *,
+                                      const uint32_t *, int, int,
+                                      int32_t, int32_t,
+                                      int32_t, int32_t,
+                                      int),
+                           uint32_t *dst, double scale)
+{
+    double t;
+    int i, y;
+
+    memset(dst, 0, sizeof(want));
+    t = now();
+
+    for (i = 0; i < NFRAMES; i++) {
+        for (y = 0; y < HEIGHT; y++) {
+            int32_t u, v, du, dv;
+            int k0, n;
+
+            k0 = spans[y][0];
+            n = spans[y][1] - k0;
+            if (n <= 0) continue;
+
+            line(scale, y, &u, &v, &du, &dv);
+            fn(&dst[y * WIDTH + k0], src, WIDTH, HEIGHT,
+               u + k0 * du, v + k0 * dv, du, dv, n);
+        }
+    }
+
+    return (now() - t) * 1000 / NFRAMES;
+}
+
+/* a third transparent, a third opaque, the rest in between */
+
+static void fill(void)
+{
+    uint8_t rgba[4];
+    int i;
+
+    srand(1);
+
+    for (i = 0; i < WIDTH * HEIGHT; i++) {
+        int k;
+
+        for (k = 0; k < 3; k++) rgba[k] = rand() & 0xff;
+
+        switch (rand() % 3) {
+            case 0: rgba[3] = 0; break;
+            case 1: rgba[3] = 255; break;
+            default: rgba[3] = rand() & 0xff; break;
+        }
+
+        sg_blit_premultiply(rgba, &src[i], 1);
+        base[i] = 0xff000000 | ((uint32_t)rand() << 8 ^ (uint32_t)rand());
+    }
+}
+
+static double bench(void (*fn)(uint32_t *, const uint32_t *, int, int),
+                    uint32_t *dst, int opacity)
+{
+    double t;
+    int i, y;
+
+    t = 0;
+
+    for (i = 0; i < NFRAMES; i++) {
+        double t0;
+
+        memcpy(dst, base, sizeof(base));
+
+        t0 = now();
+        for (y = 0; y < HEIGHT; y++) {
+            fn(&dst[y * WIDTH], &src[y * WIDTH], WIDTH, opacity);
+        }
+        t += now() - t0;
+    }
+
+    return t * 1000 / NFRAMES;
+}
+
+int main(int argc, char *argv[])
+{
+    static const int opacities[] = {255, 128, 37};
+    static const double scales[] = {2, 0.8};
+    int k;
+
+    fill();
+
+    printf("%dx%d over, ms/frame\n", WIDTH, HEIGHT);
+    printf("opacity  scalar  sg_blit_over  speedup\n");
+
+    for (k = 0; k < (int)(sizeof(opacities) / sizeof(opacities[0])); k++) {
+        double ms_ref, ms;
+
+        ms_ref = bench(over_ref, want, opacities[k]);
+        ms = bench(sg_blit_over, got, opacities[k]);
+
+        if (memcmp(want, got, sizeof(want)) != 0) {
+            fprintf(stderr, "blit: over differs at opacity %d\n",
+                    opacities[k]);
+            return 1;
+        }
+
+        printf("%7d  %6.2f  %12.2f  %7.2f\n",
+               opacities[k], ms_ref, ms, ms_ref / ms);
+    }
+
+    printf("\n%dx%d turned sampling, ms/frame\n", WIDTH, HEIGHT);
+    printf("scale  scalar  sg_blit_sample  speedup\n");
+
+    for (k = 0; k < (int)(sizeof(scales) / sizeof(scales[0])); k++) {
+        double ms_ref, ms;
+
+        clip(scales[k]);
+        ms_ref = bench_sample(sample_ref, want, scales[k]);
+        ms = bench_sample(sg_blit_sample, got, scales[k]);
+
+        if (memcmp(want, got, sizeof(want)) != 0) {
+            fprintf(stderr, "blit: sampling differs at scale %g\n",
+                    scales[k]);
+            return 1;
+        }
+
+        printf("%5.1f  %6.2f  %14.2f  %7.2f\n",
+               scales[k], ms_ref, ms, ms_ref / ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * Times blending a color over 1080p frames with per-pixel
+ * amounts: the original per-pixel sg_colorlerp, the table
+ * blend the span API started with, and sg_colorlerp_span
+ * and sg_colorlerp_span8 as they run on this CPU. Then the
+ * per-pixel sg_colorlerp_lin image mix against
+ * sg_colorlerp_mix.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../colorlerp.h"
+#include "../lintables.h"
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define NFRAMES 10
+
+static uint32_t frame[WIDTH * HEIGHT];
+static float amt[WIDTH * HEIGHT];
+static uint8_t cov[WIDTH * HEIGHT];
+static uint32_t image[WIDTH * HEIGHT];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill(void)
+{
+    int i;
+
+    srand(1);
+
+    for (i = 0; i < WIDTH * HEIGHT; i++) {
+        frame[i] = (uint32_t)rand() << 8 ^ (uint32_t)rand();
+        amt[i] = (rand() % 1001) / 1000.f;
+        cov[i] = amt[i] * 255;
+        image[i] = (uint32_t)rand() << 8 ^ (uint32_t)rand();
+    }
+}
+
+static void old_frame(uint32_t clr)
+{
+    int i;
+
+    for (i = 0; i < WIDTH * HEIGHT; i++) {
+        uint32_t p;
+        uint8_t r, g, b;
+
+        p = frame[i];
+        sg_colorlerp((p >> 16) & 0xff, (p >> 8) & 0xff, p & 0xff,
+                     (clr >> 16) & 0xff, (clr >> 8) & 0xff, clr & 0xff,
+                     amt[i], &r, &g, &b);
+        frame[i] = 0xff000000 | r << 16 | g << 8 | b;
+    }
+}
+
+static void table_frame(uint32_t clr)
+{
+    float lin[3];
+    int i;
+
+    lin[0] = srgb2lin[(clr >> 16) & 0xff];
+    lin[1] = srgb2lin[(clr >> 8) & 0xff];
+    lin[2] = srgb2lin[clr & 0xff];
+
+    for (i = 0; i < WIDTH * HEIGHT; i++) {
+        uint32_t p;
+        float a, r, g, b;
+
+        p = frame[i];
+        a = amt[i];
+
+        if (a <= 0) continue;
+        if (a >= 1) {
+            frame[i] = 0xff000000 | clr;
+            continue;
+        }
+
+        r = (1 - a) * srgb2lin[(p >> 16) & 0xff] + a * lin[0];
+        g = (1 - a) * srgb2lin[(p >> 8) & 0xff] + a * lin[1];
+        b = (1 - a) * srgb2lin[p & 0xff] + a * lin[2];
+
+        frame[i] = 0xff000000 |
+            (uint32_t)lin2srgb[(int)(r * (LINTABLE_SIZE - 1) + 0.5f)] << 16 |
+            (uint32_t)lin2srgb[(int)(g * (LINTABLE_SIZE - 1) + 0.5f)] << 8 |
+            (uint32_t)lin2srgb[(int)(b * (LINTABLE_SIZE - 1) + 0.5f)];
+    }
+}
+
+static void span_frame(uint32_t clr)
+{
+    int y;
+
+    for (y = 0; y < HEIGHT; y++) {
+        sg_colorlerp_span(&frame[y * WIDTH], WIDTH, clr,
+                          &amt[y * WIDTH], 0);
+    }
+}
+
+static void span8_frame(uint32_t clr)
+{
+    int y;
+
+    for (y = 0; y < HEIGHT; y++) {
+        sg_colorlerp_span8(&frame[y * WIDTH], WIDTH, clr,
+                           &cov[y * WIDTH], 1, 1);
+    }
+}
+
+static void lin_frame(uint32_t clr)
+{
+    float a;
+    int i;
+
+    a = (clr & 0xff) / 255.f;
+
+    for (i = 0; i < WIDTH * HEIGHT; i++) {
+        uint32_t p, q;
+        uint8_t r, g, b;
+
+        p = frame[i];
+        q = image[i];
+        sg_colorlerp_lin((p >> 16) & 0xff, (p >> 8) & 0xff, p & 0xff,
+                         (q >> 16) & 0xff, (q >> 8) & 0xff, q & 0xff,
+                         a, &r, &g, &b);
+        frame[i] = 0xff000000 | r << 16 | g << 8 | b;
+    }
+}
+
+static void mix_frame(uint32_t clr)
+{
+    int y;
+
+    for (y = 0; y < HEIGHT; y++) {
+        sg_colorlerp_mix(&frame[y * WIDTH], &image[y * WIDTH], WIDTH,
+                         (clr & 0xff) / 255.f);
+    }
+}
+
+static double bench(const char *name, void (*fn)(uint32_t), double base)
+{
+    double t, ms;
+    int i;
+
+    fill();
+    fn(0x7fa9fd);
+
+    t = now();
+    for (i = 0; i < NFRAMES; i++) fn(i & 1 ? 0x7fa9fd : 0x3b4252);
+    ms = (now() - t) * 1000 / NFRAMES;
+
+    if (base <= 0) base = ms;
+    printf("%-20s %8.2f ms/frame %6.2fx\n", name, ms, base / ms);
+
+    return ms;
+}
+
+int main(int argc, char *argv[])
+{
+    double base;
+
+    sg_colorlerp_init();
+
+    printf("%dx%d, per-pixel amounts\n", WIDTH, HEIGHT);
+    base = bench("sg_colorlerp", old_frame, 0);
+    bench("table span", table_frame, base);
+    bench("sg_colorlerp_span", span_frame, base);
+    bench("sg_colorlerp_span8", span8_frame, base);
+
+    printf("\n%dx%d, image mix\n", WIDTH, HEIGHT);
+    base = bench("sg_colorlerp_lin", lin_frame, 0);
+    bench("sg_colorlerp_mix", mix_frame, base);
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * Checks the sRGB span blend, which runs on SIMD kernels with
+ * polynomial transfer curves where the CPU has them, against
+ * the table blend it replaced. Every 8-bit value is blended
+ * with colors over a sweep of amounts. No channel may be off
+ * by more than 1, and amounts of 0 and 1 must be exact.
+ * The row mix must match sg_colorlerp_lin exactly.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../colorlerp.h"
+#include "../lintables.h"
+
+#define NAMTS 1024
+
+/* the table blend, as the scalar span does it */
+
+static uint32_t blend(uint32_t p, uint32_t clr, float a)
+{
+    float lin[3];
+    float c[3];
+    int i;
+
+    if (a <= 0) return p;
+    if (a >= 1) return clr | 0xff000000;
+
+    for (i = 0; i < 3; i++) {
+        int s;
+        s = 16 - 8*i;
+        lin[i] = srgb2lin[(clr >> s) & 0xff];
+        c[i] = srgb2lin[(p >> s) & 0xff];
+        c[i] = (1 - a) * c[i] + a * lin[i];
+    }
+
+    return 0xff000000 |
+        (uint32_t)lin2srgb[(int)(c[0] * (LINTABLE_SIZE - 1) + 0.5f)] << 16 |
+        (uint32_t)lin2srgb[(int)(c[1] * (LINTABLE_SIZE - 1) + 0.5f)] << 8 |
+        (uint32_t)lin2srgb[(int)(c[2] * (LINTABLE_SIZE - 1) + 0.5f)];
+}
+
+/* sg_colorlerp_mix against sg_colorlerp_lin, pixel by pixel */
+
+static int check_mix(void)
+{
+    static uint32_t dst[4099], src[4099], want[4099];
+    int i, k;
+
+    srand(1);
+
+    for (k = 0; k <= NAMTS; k++) {
+        float a;
+
+        a = (float)k / NAMTS;
+
+        for (i = 0; i < 4099; i++) {
+            uint8_t r, g, b;
+
+            dst[i] = (uint32_t)rand() << 8 ^ (uint32_t)rand();
+            src[i] = (uint32_t)rand() << 8 ^ (uint32_t)rand();
+
+            sg_colorlerp_lin((dst[i] >> 16) & 0xff, (dst[i] >> 8) & 0xff,
+                             dst[i] & 0xff,
+                             (src[i] >> 16) & 0xff, (src[i] >> 8) & 0xff,
+                             src[i] & 0xff,
+                             a, &r, &g, &b);
+            want[i] = 0xff000000 | r << 16 | g << 8 | b;
+        }
+
+        sg_colorlerp_mix(dst, src, 4099, a);
+
+        for (i = 0; i < 4099; i++) {
+            if (dst[i] != want[i]) {
+                fprintf(stderr,
+                        "colorlerp mix: pixel %d at %g is %08x, not %08x\n",
+                        i, a, dst[i], want[i]);
+                return 1;
+            }
+        }
+    }
+
+    printf("colorlerp mix: exact\n");
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint32_t colors[] = {
+        0x000000, 0xffffff, 0x3b4252, 0x7fa9fd, 0x09021d, 0xff0000
+    };
+    static uint32_t row[256 * NAMTS];
+    static float amt[256 * NAMTS];
+    int c, i, k;
+    long ndiff, n;
+    int maxd;
+
+    ndiff = 0;
+    n = 0;
+    maxd = 0;
+
+    for (c = 0; c < (int)(sizeof(colors) / sizeof(colors[0])); c++) {
+        /* every gray level and a rotated copy in r, g, b */
+        for (k = 0; k < NAMTS; k++) {
+            for (i = 0; i < 256; i++) {
+                row[k*256 + i] = i << 16 | ((i + 85) & 0xff) << 8 |
+                    ((i + 170) & 0xff);
+                amt[k*256 + i] = (float)k / (NAMTS - 1);
+            }
+        }
+
+        sg_colorlerp_span(row, 256 * NAMTS, colors[c], amt, 0);
+
+        for (k = 0; k < NAMTS; k++) {
+            for (i = 0; i < 256; i++) {
+                uint32_t p, want, got;
+                int s;
+
+                p = i << 16 | ((i + 85) & 0xff) << 8 | ((i + 170) & 0xff);
+                want = blend(p, colors[c], amt[k*256 + i]);
+                got = row[k*256 + i];
+
+                if ((k == 0 || k == NAMTS - 1) && want != got) {
+                    fprintf(stderr, "colorlerp: amount %d not exact\n", k);
+                    return 1;
+                }
+
+                for (s = 0; s < 24; s += 8) {
+                    int d;
+                    d = abs((int)((want >> s) & 0xff) -
+                            (int)((got >> s) & 0xff));
+                    if (d > 0) ndiff++;
+                    if (d > maxd) maxd = d;
+                    n++;
+                }
+            }
+        }
+    }
+
+    printf("colorlerp span: %ld of %ld channels differ, max |d| = %d\n",
+           ndiff, n, maxd);
+
+    if (maxd > 1) {
+        fprintf(stderr, "colorlerp span: error bound exceeded\n");
+        return 1;
+    }
+
+    return check_mix();
+}
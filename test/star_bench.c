@@ -0,0 +1,96 @@
+/*
+ * Times the star shader on a 4K unshade buffer, first with
+ * the default tiles over 1 to 64 pool threads, then with
+ * several tile sizes at one thread per core. A single-row
+ * "tile" as wide as the frame is the old row-at-a-time
+ * schedule.
+ *
+ * Needs x264 and cairo, like sgvideo. Nothing is encoded.
+ * The frames timed per setting can be given, default 2.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../video.h"
+#include "../pool.h"
+
+#define WIDTH 3840
+#define HEIGHT 2160
+
+void sg_video_startest(sg_video *v);
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int nframes = 2;
+
+/* milliseconds per frame */
+
+static double run(sg_video *v)
+{
+    double t;
+    int i;
+
+    /* the first frame pays for waking the pool */
+    sg_video_startest(v);
+
+    t = now();
+    for (i = 0; i < nframes; i++) sg_video_startest(v);
+
+    return (now() - t) * 1000.0 / nframes;
+}
+
+int main(int argc, char *argv[])
+{
+    sg_video *v;
+    double ms, ms1;
+    int n, i;
+    int ncores;
+    static const int tiles[][2] = {
+        {16, 16}, {32, 8}, {64, 16}, {128, 32}, {256, 64},
+        {WIDTH, 1}
+    };
+
+    if (argc > 1) nframes = atoi(argv[1]);
+    if (nframes < 1) nframes = 1;
+
+    sg_video_new(&v);
+    sg_video_open(v, "/dev/null", WIDTH, HEIGHT, 60);
+    sg_video_unshade_init(v);
+
+    ncores = sg_pool_ncores();
+    printf("star, %dx%d, %d cores\n\n", WIDTH, HEIGHT, ncores);
+
+    printf("threads  ms/frame  speedup\n");
+    ms1 = 0;
+    for (n = 1; n <= 64; n *= 2) {
+        sg_video_threads(v, n);
+        ms = run(v);
+        if (n == 1) ms1 = ms;
+        printf("%7d  %8.1f  %7.2f\n", n, ms, ms1 / ms);
+    }
+
+    sg_video_threads(v, 0);
+
+    printf("\ntile       ms/frame (%d threads)\n", ncores);
+    for (i = 0; i < (int)(sizeof(tiles) / sizeof(tiles[0])); i++) {
+        char name[16];
+
+        sg_video_unshade_tile(v, tiles[i][0], tiles[i][1]);
+        ms = run(v);
+        sprintf(name, "%dx%d", tiles[i][0], tiles[i][1]);
+        printf("%-9s  %8.1f\n", name, ms);
+    }
+
+    sg_video_close(v);
+    sg_video_del(&v);
+    return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * Checks the fixed-point RGB to YUV444 converter against the
+ * double precision rgb2yuv it replaced, over the whole RGB
+ * cube. The two round differently, so they may disagree, but
+ * never by more than 1.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../yuv.h"
+
+/* the original per-pixel converter from video.c */
+
+static void rgb2yuv(uint8_t r, uint8_t g, uint8_t b,
+                    uint8_t *y, uint8_t *u, uint8_t *v)
+{
+    double Ey;
+    double Ecr;
+    double Ecb;
+    double norm;
+
+    norm = 1.0/255;
+
+    Ey = (0.299*r + 0.587*g + 0.114*b)*norm;
+    Ecr = 0.713 * (r*norm - Ey);
+    Ecb = 0.564 * (b*norm - Ey);
+
+    *y = Ey * 255;
+    *u = (0.5 + Ecb) * 255;
+    *v = (0.5 + Ecr) * 255;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t *pix;
+    uint8_t *y, *u, *v;
+    int r, g, b;
+    int maxd;
+    long ndiff;
+
+    /* one red value at a time: 256 rows of 256 blues */
+    pix = malloc(sizeof(uint32_t) * 256 * 256);
+    y = malloc(256 * 256);
+    u = malloc(256 * 256);
+    v = malloc(256 * 256);
+
+    if (pix == NULL || y == NULL || u == NULL || v == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    maxd = 0;
+    ndiff = 0;
+
+    for (r = 0; r < 256; r++) {
+        for (g = 0; g < 256; g++) {
+            for (b = 0; b < 256; b++) {
+                pix[g*256 + b] = r << 16 | g << 8 | b;
+            }
+        }
+
+        sg_yuv444(pix, 256 * 4, 256, 256,
+                  y, 256, u, 256, v, 256);
+
+        for (g = 0; g < 256; g++) {
+            for (b = 0; b < 256; b++) {
+                uint8_t ry, ru, rv;
+                int d[3];
+                int i, pos;
+
+                pos = g*256 + b;
+                rgb2yuv(r, g, b, &ry, &ru, &rv);
+
+                d[0] = abs(y[pos] - ry);
+                d[1] = abs(u[pos] - ru);
+                d[2] = abs(v[pos] - rv);
+
+                for (i = 0; i < 3; i++) {
+                    if (d[i] > 0) ndiff++;
+                    if (d[i] > maxd) maxd = d[i];
+                }
+            }
+        }
+    }
+
+    free(pix);
+    free(y);
+    free(u);
+    free(v);
+
+    printf("yuv444: %ld of %d samples differ, max |d| = %d\n",
+           ndiff, 256 * 256 * 256 * 3, maxd);
+
+    if (maxd > 1) {
+        fprintf(stderr, "yuv444: error bound exceeded\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2021 Muvik Labs, LLC
+ * Distributed under the MIT license.
+ */
+
+/*
+ * Cache of rasterized text runs: the coverage of a whole
+ * string as fontstash drew it, keyed by the string and the
+ * state it was drawn with. Runs are kept in a hash table
+ * and a most-recently-used list, and the least recently
+ * used are dropped to stay under a byte cap.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "textcache.h"
+
+#define NBUCKETS 1024
+
+struct sg_textcache {
+    sg_textrun *buckets[NBUCKETS];
+
+    /* most recently used first */
+    sg_textrun *head;
+    sg_textrun *tail;
+
+    size_t size;
+    size_t cap;
+
+    long hits, misses;
+};
+
+static size_t run_size(sg_textrun *r)
+{
+    return sizeof(sg_textrun) + r->len + (size_t)r->w * r->h;
+}
+
+/* FNV-1a over the string, then the key */
+
+static unsigned int fnv(unsigned int h, const void *p, size_t n)
+{
+    const unsigned char *c;
+    size_t i;
+
+    c = p;
+
+    for (i = 0; i < n; i++) {
+        h ^= c[i];
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+static unsigned int hash_run(const sg_textkey *key, const char *str, int len)
+{
+    unsigned int h;
+
+    h = fnv(2166136261u, str, len);
+    h = fnv(h, &key->font, sizeof(key->font));
+    h = fnv(h, &key->size, sizeof(key->size));
+    h = fnv(h, &key->blur, sizeof(key->blur));
+    h = fnv(h, &key->align, sizeof(key->align));
+    h = fnv(h, &key->fx, sizeof(key->fx));
+    h = fnv(h, &key->fy, sizeof(key->fy));
+
+    return h;
+}
+
+static int same_key(const sg_textkey *a, const sg_textkey *b)
+{
+    return a->font == b->font &&
+        a->size == b->size &&
+        a->blur == b->blur &&
+        a->align == b->align &&
+        a->fx == b->fx &&
+        a->fy == b->fy;
+}
+
+static void unlink_lru(sg_textcache *tc, sg_textrun *r)
+{
+    if (r->prev != NULL) r->prev->next = r->next;
+    else tc->head = r->next;
+
+    if (r->next != NULL) r->next->prev = r->prev;
+    else tc->tail = r->prev;
+
+    r->prev = r->next = NULL;
+}
+
+static void push_lru(sg_textcache *tc, sg_textrun *r)
+{
+    r->prev = NULL;
+    r->next = tc->head;
+    if (tc->head != NULL) tc->head->prev = r;
+    tc->head = r;
+    if (tc->tail == NULL) tc->tail = r;
+}
+
+static void drop(sg_textcache *tc, sg_textrun *r)
+{
+    sg_textrun **p;
+
+    p = &tc->buckets[r->hash % NBUCKETS];
+    while (*p != r) p = &(*p)->chain;
+    *p = r->chain;
+
+    unlink_lru(tc, r);
+    tc->size -= run_size(r);
+
+    free(r->cov);
+    free(r->str);
+    free(r);
+}
+
+void sg_textcache_new(sg_textcache **ptc, size_t cap)
+{
+    sg_textcache *tc;
+
+    tc = calloc(1, sizeof(sg_textcache));
+    tc->cap = cap;
+
+    *ptc = tc;
+}
+
+void sg_textcache_clear(sg_textcache *tc)
+{
+    while (tc->head != NULL) drop(tc, tc->head);
+}
+
+void sg_textcache_del(sg_textcache **ptc)
+{
+    if (*ptc == NULL) return;
+
+    sg_textcache_clear(*ptc);
+    free(*ptc);
+    *ptc = NULL;
+}
+
+/*
+ * Splits a pen position into the whole pixel ix, iy and the
+ * nearest subpixel step within it, which goes in the key. A
+ * caption moving by fractions of a pixel then only ever needs
+ * SG_TEXT_SUBPIXEL squared runs, and is drawn within half a
+ * step of where it was asked for.
+ */
+
+void sg_textcache_snap(sg_textkey *key, float x, float y, int *ix, int *iy)
+{
+    int sx, sy;
+
+    sx = floor(x * SG_TEXT_SUBPIXEL + 0.5);
+    sy = floor(y * SG_TEXT_SUBPIXEL + 0.5);
+
+    *ix = floor((double)sx / SG_TEXT_SUBPIXEL);
+    *iy = floor((double)sy / SG_TEXT_SUBPIXEL);
+
+    key->fx = (float)(sx - *ix * SG_TEXT_SUBPIXEL) / SG_TEXT_SUBPIXEL;
+    key->fy = (float)(sy - *iy * SG_TEXT_SUBPIXEL) / SG_TEXT_SUBPIXEL;
+}
+
+void sg_textcache_stats(sg_textcache *tc,
+                        long *hits, long *misses,
+                        size_t *size)
+{
+    *hits = tc->hits;
+    *misses = tc->misses;
+    *size = tc->size;
+}
+
+/* looks up a run, marking it most recently used */
+
+sg_textrun * sg_textcache_find(sg_textcache *tc,
+                               const sg_textkey *key,
+                               const char *str, int len)
+{
+    unsigned int h;
+    sg_textrun *r;
+
+    h = hash_run(key, str, len);
+
+    for (r = tc->buckets[h % NBUCKETS]; r != NULL; r = r->chain) {
+        if (r->hash == h &&
+            r->len == len &&
+            same_key(&r->key, key) &&
+            memcmp(r->str, str, len) == 0) {
+            unlink_lru(tc, r);
+            push_lru(tc, r);
+            tc->hits++;
+            return r;
+        }
+    }
+
+    tc->misses++;
+    return NULL;
+}
+
+/*
+ * Adds a run with a cleared w by h coverage bitmap for the
+ * caller to fill, dropping old runs to make room. Returns
+ * NULL when the run is empty or would not fit at all.
+ */
+
+sg_textrun * sg_textcache_add(sg_textcache *tc,
+                              const sg_textkey *key,
+                              const char *str, int len,
+                              int w, int h)
+{
+    sg_textrun *r;
+    size_t sz;
+
+    if (w <= 0 || h <= 0) return NULL;
+
+    sz = sizeof(sg_textrun) + len + (size_t)w * h;
+    if (sz > tc->cap) return NULL;
+
+    while (tc->head != NULL && tc->size + sz > tc->cap) {
+        drop(tc, tc->tail);
+    }
+
+    r = calloc(1, sizeof(sg_textrun));
+    r->key = *key;
+    r->len = len;
+    r->str = malloc(len + 1);
+    memcpy(r->str, str, len);
+    r->str[len] = '\0';
+    r->hash = hash_run(key, str, len);
+    r->w = w;
+    r->h = h;
+    r->cov = calloc((size_t)w * h, 1);
+
+    r->chain = tc->buckets[r->hash % NBUCKETS];
+    tc->buckets[r->hash % NBUCKETS] = r;
+    push_lru(tc, r);
+    tc->size += sz;
+
+    return r;
+}
@@ -0,0 +1,50 @@
+#ifndef SG_TEXTCACHE_H
+#define SG_TEXTCACHE_H
+typedef struct sg_textcache sg_textcache;
+
+/* runs are rasterized at 1/SG_TEXT_SUBPIXEL pixel steps */
+#define SG_TEXT_SUBPIXEL 4
+
+/* fontstash state a run was drawn with */
+typedef struct {
+    int font;
+    float size;
+    float blur;
+    int align;
+
+    /* position within the pixel, snapped to a subpixel step */
+    float fx, fy;
+} sg_textkey;
+
+typedef struct sg_textrun sg_textrun;
+struct sg_textrun {
+    sg_textkey key;
+    char *str;
+    int len;
+    unsigned int hash;
+
+    /* coverage, w by h, at ox, oy from the whole pixel position */
+    unsigned char *cov;
+    int w, h;
+    int ox, oy;
+    float adv;
+
+    sg_textrun *prev, *next;
+    sg_textrun *chain;
+};
+
+void sg_textcache_new(sg_textcache **ptc, size_t cap);
+void sg_textcache_del(sg_textcache **ptc);
+void sg_textcache_clear(sg_textcache *tc);
+void sg_textcache_snap(sg_textkey *key, float x, float y, int *ix, int *iy);
+void sg_textcache_stats(sg_textcache *tc,
+                        long *hits, long *misses,
+                        size_t *size);
+sg_textrun * sg_textcache_find(sg_textcache *tc,
+                               const sg_textkey *key,
+                               const char *str, int len);
+sg_textrun * sg_textcache_add(sg_textcache *tc,
+                              const sg_textkey *key,
+                              const char *str, int len,
+                              int w, int h);
+#endif
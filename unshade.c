@@ -5,10 +5,14 @@
 
 #include <math.h>
 #include <stdlib.h>
-#include <pthread.h>
 #include <stdio.h>
 
 #include "unshade.h"
+#include "pool.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
 
 us_vec2 us_mkvec2(float x, float y)
 {
@@ -238,45 +242,161 @@ us_vec2 us_add2sv(float s, us_vec2 v)
     return out;
 }
 
-#define US_MAXTHREADS 8
+/*
+ * us_draw works in tiles, sized so a tile of us_vec3 pixels
+ * stays in L1 cache. Neighbouring threads no longer write to
+ * adjacent rows, and the pool's stealing balances tiles where
+ * the shader is more expensive.
+ */
 
 typedef struct {
     us_vec3 *buf;
+    us_planes *planes;
     us_image_data *data;
-    int off;
     void (*draw)(us_vec3 *, us_vec2, us_image_data *);
-} thread_data;
+    void (*span)(float *, float *, float *, int, us_vec2, us_image_data *);
+    int tw, th;
+    int ntx;
+} draw_job;
+
+/*
+ * Runs a span shader over part of a row. The pixels are split
+ * into planar r/g/b arrays, shaded, and then packed back.
+ */
+
+static void draw_span(draw_job *job, us_vec3 *row, int x0, int x1, int y)
+{
+    float r[US_SPAN];
+    float g[US_SPAN];
+    float b[US_SPAN];
+    int x, n, i;
+
+    for (x = x0; x < x1; x += n) {
+        n = x1 - x;
+        if (n > US_SPAN) n = US_SPAN;
+
+        for (i = 0; i < n; i++) {
+            r[i] = row[x + i].x;
+            g[i] = row[x + i].y;
+            b[i] = row[x + i].z;
+        }
+
+        job->span(r, g, b, n, us_mkvec2(x, y), job->data);
+
+        for (i = 0; i < n; i++) {
+            row[x + i].x = r[i];
+            row[x + i].y = g[i];
+            row[x + i].z = b[i];
+        }
+    }
+}
+
+/*
+ * Planar rows go to span shaders as they are. Per-pixel
+ * shaders get each pixel packed into a us_vec3.
+ */
+
+static void draw_planar_row(draw_job *job, int x0, int x1, int y)
+{
+    float *r, *g, *b;
+    int x, n;
+
+    r = job->planes->r + y * job->planes->stride;
+    g = job->planes->g + y * job->planes->stride;
+    b = job->planes->b + y * job->planes->stride;
+
+    if (job->span != NULL) {
+        for (x = x0; x < x1; x += n) {
+            n = x1 - x;
+            if (n > US_SPAN) n = US_SPAN;
+            job->span(r + x, g + x, b + x, n, us_mkvec2(x, y), job->data);
+        }
+        return;
+    }
+
+    for (x = x0; x < x1; x++) {
+        us_vec3 c;
+        c = us_mkvec3(r[x], g[x], b[x]);
+        job->draw(&c, us_mkvec2(x, y), job->data);
+        r[x] = c.x;
+        g[x] = c.y;
+        b[x] = c.z;
+    }
+}
 
-void *draw_thread(void *arg)
+static void draw_tile(void *ud, int tile, int thread)
 {
-    thread_data *td;
+    draw_job *job;
     us_image_data *data;
     int x, y;
     int w, h;
-    us_vec3 *buf;
-    int nthreads;
+    int x0, y0;
+    int x1, y1;
 
-    td = arg;
-    data = td->data;
-    buf = td->buf;
+    job = ud;
+    data = job->data;
 
     w = data->iResolution.x;
     h = data->iResolution.y;
 
-    /* This is hard-coded for now */
-    nthreads = US_MAXTHREADS;
+    x0 = (tile % job->ntx) * job->tw;
+    y0 = (tile / job->ntx) * job->th;
+    x1 = x0 + job->tw;
+    y1 = y0 + job->th;
+    if (x1 > w) x1 = w;
+    if (y1 > h) y1 = h;
 
-    for (y = td->off; y < h; y+=nthreads) {
-        for (x = 0; x < w; x++) {
-            int pos;
-            us_vec3 *c;
-            pos = y*w+ x;
-            c = &buf[pos];
-            td->draw(c, us_mkvec2(x, y), data);
+    if (job->planes != NULL) {
+        for (y = y0; y < y1; y++) {
+            draw_planar_row(job, x0, x1, y);
+        }
+        return;
+    }
+
+    for (y = y0; y < y1; y++) {
+        us_vec3 *row;
+        row = &job->buf[y * w];
+
+        if (job->span != NULL) {
+            draw_span(job, row, x0, x1, y);
+            continue;
+        }
+
+        for (x = x0; x < x1; x++) {
+            job->draw(&row[x], us_mkvec2(x, y), data);
         }
     }
+}
+
+static void draw_tiles(us_vec3 *buf,
+                       us_planes *planes,
+                       us_vec2 res,
+                       int frame,
+                       int fps,
+                       draw_job *job,
+                       void *ud,
+                       int tw, int th)
+{
+    us_image_data data;
+    int w, h;
+    int nty;
+
+    data.iResolution = res;
+    data.iTime = (float)(frame)/fps;
+    data.ud = ud;
 
-    return NULL;
+    w = res.x;
+    h = res.y;
+
+    job->buf = buf;
+    job->planes = planes;
+    job->data = &data;
+    job->tw = tw < 1 ? 1 : tw;
+    job->th = th < 1 ? 1 : th;
+    job->ntx = (w + job->tw - 1) / job->tw;
+    nty = (h + job->th - 1) / job->th;
+
+    sg_pool_run(sg_pool_global(), job->ntx * nty, draw_tile, job);
 }
 
 void us_draw(us_vec3 *buf,
@@ -286,26 +406,92 @@ void us_draw(us_vec3 *buf,
              void (*draw)(us_vec3 *, us_vec2, us_image_data *),
              void *ud)
 {
-    thread_data td[US_MAXTHREADS];
-    pthread_t thread[US_MAXTHREADS];
-    int t;
-    us_image_data data;
+    draw_job job;
 
-    data.iResolution = res;
-    data.iTime = (float)(frame)/fps;
-    data.ud = ud;
+    job.draw = draw;
+    job.span = NULL;
+    draw_tiles(buf, NULL, res, frame, fps, &job, ud,
+               US_TILE_W, US_TILE_H);
+}
 
-    for (t = 0; t < US_MAXTHREADS; t++) {
-        td[t].buf = buf;
-        td[t].data = &data;
-        td[t].off = t;
-        td[t].draw = draw;
-        pthread_create(&thread[t], NULL, draw_thread, &td[t]);
-    }
+/*
+ * Like us_draw, but the shader is called on runs of up to
+ * US_SPAN pixels of one row, beginning at the given
+ * coordinate. r, g and b hold the current colors and are
+ * shaded in place.
+ */
 
-    for (t = 0; t < US_MAXTHREADS; t++) {
-        pthread_join(thread[t], NULL);
-    }
+void us_draw_span(us_vec3 *buf,
+                  us_vec2 res,
+                  int frame,
+                  int fps,
+                  void (*span)(float *, float *, float *,
+                               int, us_vec2, us_image_data *),
+                  void *ud)
+{
+    draw_job job;
+
+    job.draw = NULL;
+    job.span = span;
+    draw_tiles(buf, NULL, res, frame, fps, &job, ud,
+               US_TILE_W, US_TILE_H);
+}
+
+/* us_draw and us_draw_span on a planar image */
+
+void us_draw_planar(us_planes *planes,
+                    us_vec2 res,
+                    int frame,
+                    int fps,
+                    void (*draw)(us_vec3 *, us_vec2, us_image_data *),
+                    void *ud)
+{
+    draw_job job;
+
+    job.draw = draw;
+    job.span = NULL;
+    draw_tiles(NULL, planes, res, frame, fps, &job, ud,
+               US_TILE_W, US_TILE_H);
+}
+
+void us_draw_span_planar(us_planes *planes,
+                         us_vec2 res,
+                         int frame,
+                         int fps,
+                         void (*span)(float *, float *, float *,
+                                      int, us_vec2, us_image_data *),
+                         void *ud)
+{
+    draw_job job;
+
+    job.draw = NULL;
+    job.span = span;
+    draw_tiles(NULL, planes, res, frame, fps, &job, ud,
+               US_TILE_W, US_TILE_H);
+}
+
+/*
+ * The general form of the above, with the tile size given.
+ * Exactly one of buf and planes, and one of draw and span,
+ * should be set.
+ */
+
+void us_draw_tiled(us_vec3 *buf,
+                   us_planes *planes,
+                   us_vec2 res,
+                   int frame,
+                   int fps,
+                   void (*draw)(us_vec3 *, us_vec2, us_image_data *),
+                   void (*span)(float *, float *, float *,
+                                int, us_vec2, us_image_data *),
+                   void *ud,
+                   int tw, int th)
+{
+    draw_job job;
+
+    job.draw = draw;
+    job.span = span;
+    draw_tiles(buf, planes, res, frame, fps, &job, ud, tw, th);
 }
 
 static int mkcolor(float x)
@@ -53,6 +53,14 @@ typedef struct {
     float w;
 } us_vec4;
 
+/* planar float image, stride is in floats */
+typedef struct {
+    float *r;
+    float *g;
+    float *b;
+    int stride;
+} us_planes;
+
 /* image data for shader-code like structures */
 typedef struct {
     us_vec2 iResolution;
@@ -105,6 +113,47 @@ void us_draw(us_vec3 *buf,
              void (*draw)(us_vec3 *, us_vec2, us_image_data *),
              void *ud);
 
+/* longest run of pixels passed to a span shader */
+#define US_SPAN 64
+
+void us_draw_span(us_vec3 *buf,
+                  us_vec2 res,
+                  int frame,
+                  int fps,
+                  void (*span)(float *, float *, float *,
+                               int, us_vec2, us_image_data *),
+                  void *ud);
+
+void us_draw_planar(us_planes *planes,
+                    us_vec2 res,
+                    int frame,
+                    int fps,
+                    void (*draw)(us_vec3 *, us_vec2, us_image_data *),
+                    void *ud);
+
+void us_draw_span_planar(us_planes *planes,
+                         us_vec2 res,
+                         int frame,
+                         int fps,
+                         void (*span)(float *, float *, float *,
+                                      int, us_vec2, us_image_data *),
+                         void *ud);
+
+/* default us_draw tile, about 12KB of us_vec3 pixels */
+#define US_TILE_W 64
+#define US_TILE_H 16
+
+void us_draw_tiled(us_vec3 *buf,
+                   us_planes *planes,
+                   us_vec2 res,
+                   int frame,
+                   int fps,
+                   void (*draw)(us_vec3 *, us_vec2, us_image_data *),
+                   void (*span)(float *, float *, float *,
+                                int, us_vec2, us_image_data *),
+                   void *ud,
+                   int tw, int th);
+
 void us_write_ppm(us_vec3 *buf, us_vec2 res, const char *filename);
 
 float us_radians(float deg);
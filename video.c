@@ -6,6 +6,8 @@
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 #include <x264.h>
 #include <cairo/cairo.h>
 #include <stdio.h>
@@ -19,6 +21,12 @@
 #include "video.h"
 
 #include "colorlerp.h"
+#include "yuv.h"
+#include "mp4.h"
+#include "pool.h"
+#include "blit.h"
+#include "skyline.h"
+#include "textcache.h"
 
 /* included after video.h for sg_video def */
 #include "fontstash/sgfontstash.h"
@@ -36,10 +44,45 @@ void sg_video_new(sg_video **pv)
     v->fs = NULL;
     *pv = v;
     v->usbuf = NULL;
+    v->linbuf = NULL;
+    v->linear = 0;
+    v->linrow = NULL;
+    v->linrow_size = 0;
+    v->uslayout = SG_UNSHADE_PACKED;
+    v->usdither = 0;
+    v->usmem = NULL;
+    v->ustile_w = US_TILE_W;
+    v->ustile_h = US_TILE_H;
+    v->usscratch = NULL;
+    v->usscratch_size = 0;
+    v->csp = SG_VIDEO_I444;
+    v->h = NULL;
+    v->enc_threads = 0;
+    v->enc_sliced = 0;
+    v->lossless = 0;
+    v->pipeline = 0;
+    v->nring = 0;
+    v->mp4 = NULL;
+    v->textcache = NULL;
+    v->fbmdiv = 1;
+    v->fbmbuf = NULL;
+    v->fbmbuf_size = 0;
+    v->fbmfield = NULL;
+    v->atlas_w = 512;
+    v->atlas_h = 512;
+    v->atlas_max = SG_TEXT_ATLAS_MAX;
+    v->atlas_grows = 0;
+    v->atlas_resets = 0;
+
+    /* blend kernels are picked once, before any thread draws */
+    sg_colorlerp_init();
+    sg_blit_init();
 }
 
 void sg_video_del(sg_video **pv)
 {
+    free((*pv)->usscratch);
+    free((*pv)->linrow);
     free(*pv);
 }
 
@@ -78,6 +121,50 @@ void sg_video_cairo_init(sg_video *v, int w, int h)
     cairo_set_antialias(cr, CAIRO_ANTIALIAS_BEST);
 }
 
+/* what fonsClearState sets */
+
+static void text_state_clear(sg_video *v)
+{
+    v->text_font = 0;
+    v->text_size = 12;
+    v->text_blur = 0;
+    v->text_align = FONS_ALIGN_LEFT | FONS_ALIGN_BASELINE;
+    v->text_color = 0xffffffff;
+}
+
+/*
+ * Called by fontstash when a glyph does not fit. The atlas
+ * doubles along its shorter side until both sides reach the
+ * max, after which it is cleared and the glyphs in use are
+ * rasterized again.
+ */
+
+static void atlas_full(void *ud, int err, int val)
+{
+    sg_video *v;
+    int w, h;
+
+    if (err != FONS_ATLAS_FULL) return;
+
+    v = ud;
+    fonsGetAtlasSize(v->fs, &w, &h);
+
+    if (w < v->atlas_max || h < v->atlas_max) {
+        if (w <= h && w < v->atlas_max) w *= 2;
+        else h *= 2;
+        if (w > v->atlas_max) w = v->atlas_max;
+        if (h > v->atlas_max) h = v->atlas_max;
+
+        if (fonsExpandAtlas(v->fs, w, h)) {
+            v->atlas_grows++;
+            return;
+        }
+    }
+
+    fonsResetAtlas(v->fs, w, h);
+    v->atlas_resets++;
+}
+
 void sg_video_fontstash_init(sg_video *v)
 {
     if (v->fs != NULL) {
@@ -86,17 +173,352 @@ void sg_video_fontstash_init(sg_video *v)
         return;
     }
 
-    v->fs = sgfons_create(512, 512, FONS_ZERO_TOPLEFT, v);
+    v->fs = sgfons_create(v->atlas_w, v->atlas_h, FONS_ZERO_TOPLEFT, v);
+    fonsSetErrorCallback(v->fs, atlas_full, v);
+    v->atlas_grows = 0;
+    v->atlas_resets = 0;
+    text_state_clear(v);
+}
+
+/*
+ * Size of the glyph atlas, and the largest side it may grow
+ * to when full. Takes effect at once if fontstash is already
+ * running, dropping the glyphs rasterized so far.
+ */
+
+void sg_video_text_atlas(sg_video *v, int w, int h, int max)
+{
+    if (w < 1) w = 1;
+    if (h < 1) h = 1;
+    if (max < w) max = w;
+    if (max < h) max = h;
+
+    v->atlas_w = w;
+    v->atlas_h = h;
+    v->atlas_max = max;
+
+    if (v->fs != NULL) fonsResetAtlas(v->fs, w, h);
+}
+
+void sg_video_text_atlas_stats(sg_video *v, sg_text_atlas_stats *s)
+{
+    memset(s, 0, sizeof(sg_text_atlas_stats));
+    if (v->fs == NULL) return;
+
+    fonsGetAtlasSize(v->fs, &s->w, &s->h);
+    fonsGetGlyphStats(v->fs, &s->hits, &s->misses, &s->rasters);
+    s->grows = v->atlas_grows;
+    s->resets = v->atlas_resets;
+}
+
+/* must be called before sg_video_open */
+
+void sg_video_colorspace(sg_video *v, int csp)
+{
+    v->csp = csp;
+}
+
+/*
+ * Number of x264 encoder threads, 0 lets x264 choose.
+ * Sliced threads trade some compression for lower latency.
+ * Must be called before sg_video_open.
+ */
+
+void sg_video_encoder_threads(sg_video *v, int nthreads, int sliced)
+{
+    v->enc_threads = nthreads;
+    v->enc_sliced = sliced;
+}
+
+/*
+ * Lossless encoding (constant QP 0, High 4:4:4 Predictive
+ * profile), in place of the default CRF. Decoded frames then
+ * match the YUV that went in whatever the thread settings.
+ * Must be called before sg_video_open.
+ */
+
+void sg_video_lossless(sg_video *v, int on)
+{
+    v->lossless = on;
+}
+
+/*
+ * Size of the frame ring for pipelined encoding. When
+ * non-zero, sg_video_append queues a copy of the frame for
+ * a background thread to convert and encode, blocking only
+ * when all nframes slots are in use. 0 encodes in place.
+ * Must be called before sg_video_open.
+ */
+
+void sg_video_pipeline(sg_video *v, int nframes)
+{
+    if (nframes < 0) nframes = 0;
+    v->pipeline = nframes;
+}
+
+/*
+ * Number of threads in the shared pool used by us_draw,
+ * sg_video_fbm and the other parallel draws. 0 uses one per
+ * core. The pool is process-wide, not part of v: the setting
+ * applies to every video and outlasts sg_video_close. The
+ * pool is freed at exit.
+ */
+
+void sg_video_threads(sg_video *v, int nthreads)
+{
+    sg_pool_global_resize(nthreads);
+}
+
+/* converts RGB pixels into the x264 picture */
+
+static void convert_frame(sg_video *v, const uint32_t *buf)
+{
+    switch (v->csp) {
+        case SG_VIDEO_I420:
+            sg_yuv420(buf, v->stride,
+                      v->width, v->height,
+                      v->pic.img.plane[0], v->pic.img.i_stride[0],
+                      v->pic.img.plane[1], v->pic.img.i_stride[1],
+                      v->pic.img.plane[2], v->pic.img.i_stride[2]);
+            break;
+        case SG_VIDEO_NV12:
+            sg_yuv_nv12(buf, v->stride,
+                        v->width, v->height,
+                        v->pic.img.plane[0], v->pic.img.i_stride[0],
+                        v->pic.img.plane[1], v->pic.img.i_stride[1]);
+            break;
+        default:
+            sg_yuv444(buf, v->stride,
+                      v->width, v->height,
+                      v->pic.img.plane[0], v->pic.img.i_stride[0],
+                      v->pic.img.plane[1], v->pic.img.i_stride[1],
+                      v->pic.img.plane[2], v->pic.img.i_stride[2]);
+            break;
+    }
+}
+
+/* NALs of a frame are contiguous, starting at the first payload */
+
+static void write_frame(sg_video *v, int i_frame_size)
+{
+    if (i_frame_size <= 0) return;
+
+    if (v->mp4 != NULL) {
+        sg_mp4_write(v->mp4,
+                     v->nal->p_payload, i_frame_size,
+                     v->pic_out.b_keyframe,
+                     v->pic_out.i_pts,
+                     v->pic_out.i_dts);
+    } else {
+        fwrite(v->nal->p_payload, i_frame_size, 1, v->fp);
+    }
+}
+
+static void encode_frame(sg_video *v, int64_t pts)
+{
+    int i_frame_size;
+
+    v->pic.i_pts = pts;
+
+    i_frame_size = x264_encoder_encode(v->h,
+                                       &v->nal,
+                                       &v->i_nal,
+                                       &v->pic,
+                                       &v->pic_out);
+
+    write_frame(v, i_frame_size);
+}
+
+/*
+ * Encoder thread for the pipelined mode. Frames are taken
+ * from the tail of the ring, and each slot is handed back
+ * to sg_video_append as soon as it has been converted, so
+ * drawing can continue while x264 encodes.
+ */
+
+static void *encode_thread(void *ud)
+{
+    sg_video *v;
+
+    v = ud;
+
+    pthread_mutex_lock(&v->ring_lock);
+
+    while (1) {
+        int slot;
+        int64_t pts;
+
+        while (v->ring_count == 0 && !v->ring_done) {
+            pthread_cond_wait(&v->ring_filled, &v->ring_lock);
+        }
+
+        if (v->ring_count == 0) break;
+
+        slot = v->ring_tail;
+        pts = v->ring_pts[slot];
+        pthread_mutex_unlock(&v->ring_lock);
+
+        convert_frame(v, v->ring[slot]);
+
+        pthread_mutex_lock(&v->ring_lock);
+        v->ring_tail = (slot + 1) % v->nring;
+        v->ring_count--;
+        pthread_cond_signal(&v->ring_freed);
+        pthread_mutex_unlock(&v->ring_lock);
+
+        encode_frame(v, pts);
+
+        pthread_mutex_lock(&v->ring_lock);
+    }
+
+    pthread_mutex_unlock(&v->ring_lock);
+
+    return NULL;
+}
+
+static void ring_free(sg_video *v, int nframes)
+{
+    int i;
+
+    if (v->ring != NULL) {
+        for (i = 0; i < nframes; i++) free(v->ring[i]);
+    }
+
+    free(v->ring);
+    free(v->ring_pts);
+    v->ring = NULL;
+    v->ring_pts = NULL;
+    v->nring = 0;
+}
+
+/*
+ * If the ring or the encoder thread can't be made, nring
+ * stays 0 and frames are encoded in sg_video_append as
+ * though the pipeline was never asked for.
+ */
+
+static void pipeline_start(sg_video *v, int nframes)
+{
+    int i;
+
+    v->ring = calloc(nframes, sizeof(uint32_t *));
+    v->ring_pts = malloc(sizeof(int64_t) * nframes);
+
+    if (v->ring == NULL || v->ring_pts == NULL) {
+        fprintf(stderr, "Could not allocate the frame ring, "
+                "encoding synchronously\n");
+        ring_free(v, 0);
+        return;
+    }
+
+    for (i = 0; i < nframes; i++) {
+        v->ring[i] = malloc(v->stride * v->height);
+
+        if (v->ring[i] == NULL) {
+            fprintf(stderr, "Could not allocate the frame ring, "
+                    "encoding synchronously\n");
+            ring_free(v, i);
+            return;
+        }
+    }
+
+    v->nring = nframes;
+    v->ring_head = 0;
+    v->ring_tail = 0;
+    v->ring_count = 0;
+    v->ring_done = 0;
+
+    pthread_mutex_init(&v->ring_lock, NULL);
+    pthread_cond_init(&v->ring_filled, NULL);
+    pthread_cond_init(&v->ring_freed, NULL);
+
+    if (pthread_create(&v->enc_thread, NULL, encode_thread, v) != 0) {
+        fprintf(stderr, "Could not start the encoder thread, "
+                "encoding synchronously\n");
+        pthread_cond_destroy(&v->ring_freed);
+        pthread_cond_destroy(&v->ring_filled);
+        pthread_mutex_destroy(&v->ring_lock);
+        ring_free(v, nframes);
+    }
+}
+
+/* waits for every queued frame to be encoded */
+
+static void pipeline_stop(sg_video *v)
+{
+    pthread_mutex_lock(&v->ring_lock);
+    v->ring_done = 1;
+    pthread_cond_signal(&v->ring_filled);
+    pthread_mutex_unlock(&v->ring_lock);
+
+    pthread_join(v->enc_thread, NULL);
+
+    pthread_cond_destroy(&v->ring_freed);
+    pthread_cond_destroy(&v->ring_filled);
+    pthread_mutex_destroy(&v->ring_lock);
+
+    ring_free(v, v->nring);
+}
+
+static int is_mp4(const char *filename)
+{
+    size_t len;
+    const char *ext;
+    const char *mp4;
+
+    len = strlen(filename);
+    if (len < 4) return 0;
+
+    ext = filename + len - 4;
+    mp4 = ".mp4";
+
+    while (*ext != '\0') {
+        if (tolower((unsigned char)*ext) != *mp4) return 0;
+        ext++;
+        mp4++;
+    }
+
+    return 1;
+}
+
+/* SPS and PPS go into the mp4 avcC box instead of the stream */
+
+static void mp4_headers(sg_video *v)
+{
+    x264_nal_t *nal;
+    int i_nal;
+    int i;
+
+    if (x264_encoder_headers(v->h, &nal, &i_nal) < 0) return;
+
+    for (i = 0; i < i_nal; i++) {
+        /* skip the 4-byte length prefix */
+        if (nal[i].i_type == NAL_SPS) {
+            sg_mp4_sps(v->mp4, nal[i].p_payload + 4, nal[i].i_payload - 4);
+        } else if (nal[i].i_type == NAL_PPS) {
+            sg_mp4_pps(v->mp4, nal[i].p_payload + 4, nal[i].i_payload - 4);
+        }
+    }
 }
 
+/*
+ * Filenames ending in .mp4 are written as an MP4 container,
+ * anything else as a raw Annex B H.264 stream. If the file or
+ * the muxer can't be set up, an error is printed and frames
+ * are drawn but not encoded.
+ */
+
 void sg_video_open(sg_video *v,
                    const char *filename,
                    int w, int h,
                    int fps)
 {
+    int mp4;
+
     if (v->fp != NULL) sg_video_close(v);
 
-    v->fp = fopen(filename, "w");
+    mp4 = is_mp4(filename);
+    v->fp = fopen(filename, "wb");
 
     /* set up cairo */
     sg_video_cairo_init(v, w, h);
@@ -104,12 +526,27 @@ void sg_video_open(sg_video *v,
     /* set up fontstash */
     sg_video_fontstash_init(v);
 
+    /* with no file or muxer there is no encoder, and appends do nothing */
+    if (v->fp == NULL) {
+        fprintf(stderr, "Could not open %s for writing\n", filename);
+        return;
+    }
+
+    /* the muxer decides the NAL format, so it comes before x264 */
+    if (mp4 && !sg_mp4_new(&v->mp4, v->fp, w, h, fps)) {
+        fprintf(stderr, "Could not create mp4 muxer for %s\n", filename);
+        fclose(v->fp);
+        v->fp = NULL;
+        return;
+    }
+
     /* set up x264 */
     {
 
         unsigned int sz;
         unsigned int szd4;
         x264_param_t *p;
+        const char *profile;
 
         sz = w * h;
         szd4 = sz/4;
@@ -125,133 +562,189 @@ void sg_video_open(sg_video *v,
         v->ubuf = calloc(1, sz);
         v->vbuf = calloc(1, sz);
 
-        if (x264_param_default_preset(p, "ultrafast", NULL) < 0)
+        if (x264_param_default_preset(p, "ultrafast", NULL) < 0) {
+            fprintf(stderr, "Could not set x264 preset\n");
             return;
+        }
 
         /* p->i_bitdepth = 8; */
-        /* p->i_csp = X264_CSP_I420; */
-        p->i_csp = X264_CSP_I444;
+        switch (v->csp) {
+            case SG_VIDEO_I420:
+                p->i_csp = X264_CSP_I420;
+                profile = "high";
+                break;
+            case SG_VIDEO_NV12:
+                p->i_csp = X264_CSP_NV12;
+                profile = "high";
+                break;
+            default:
+                p->i_csp = X264_CSP_I444;
+                profile = "high444";
+                break;
+        }
         p->rc.i_rc_method = X264_RC_CRF;
         p->rc.f_rf_constant_max = 2;
         p->i_width  = w;
         p->i_height = h;
         p->b_vfr_input = 0;
-        p->b_repeat_headers = 1;
-        p->b_annexb = 1;
+        p->b_repeat_headers = !mp4;
+        p->b_annexb = !mp4;
         p->i_fps_num = fps;
 
-        /* had to change threads to stop from crashing on Linux */
-        p->i_threads = 1;
-        p->i_lookahead_threads = 1;
+        /*
+         * Threads used to be forced to 1 to stop a crash on
+         * Linux. The encoder handle was never checked after
+         * x264_encoder_open (the height was tested instead), so
+         * a failed open crashed on the first append. That open
+         * is checked below now; whether it was the crash the
+         * threads were pinned for is not known.
+         */
+        p->i_threads = v->enc_threads;
+        if (p->i_threads <= 0) p->i_threads = X264_THREADS_AUTO;
+        p->i_lookahead_threads = X264_THREADS_AUTO;
+        p->b_sliced_threads = v->enc_sliced;
 
         /* try to make bitrate 7.5 mbps */
         p->rc.i_bitrate = 7500;
 
-        /* they say this means lossless */
-        p->rc.i_qp_constant = 0;
+        /* qp only applies under constant QP; 0 there is lossless */
+        if (v->lossless) {
+            p->rc.i_rc_method = X264_RC_CQP;
+            p->rc.i_qp_constant = 0;
+            profile = "high444";
+        }
 
         /* silence output */
         p->i_log_level = X264_LOG_NONE;
 
-        if (x264_param_apply_profile(p, "high444") < 0 )
+        if (x264_param_apply_profile(p, profile) < 0 ) {
+            fprintf(stderr, "Could not apply x264 profile %s\n", profile);
             return;
+        }
 
-        if (x264_picture_alloc(&v->pic, p->i_csp, p->i_width, p->i_height) < 0 )
+        if (x264_picture_alloc(&v->pic, p->i_csp, p->i_width, p->i_height) < 0 ) {
+            fprintf(stderr, "Could not allocate x264 picture\n");
             return;
+        }
+
+        sg_yuv_init();
 
         v->h = x264_encoder_open(p);
-        if (!h) return;
+        if (v->h == NULL) {
+            fprintf(stderr, "Could not open x264 encoder\n");
+            x264_picture_clean(&v->pic);
+            return;
+        }
+
+        if (v->mp4 != NULL) mp4_headers(v);
+
+        if (v->pipeline > 0) pipeline_start(v, v->pipeline);
     }
 }
 
-/* source: https://www.fourcc.org/fccyvrgb.php */
+/* waits for a free slot in the ring and returns it */
 
-void rgb2yuv(uint8_t r, uint8_t g, uint8_t b,
-             uint8_t *y, uint8_t *u, uint8_t *v)
+static int ring_acquire(sg_video *v)
 {
-    double Ey;
-    double Ecr;
-    double Ecb;
-    double norm;
+    int slot;
+
+    /* back-pressure: wait for the encoder to free a slot */
+    pthread_mutex_lock(&v->ring_lock);
+    while (v->ring_count == v->nring) {
+        pthread_cond_wait(&v->ring_freed, &v->ring_lock);
+    }
+    slot = v->ring_head;
+    pthread_mutex_unlock(&v->ring_lock);
+
+    return slot;
+}
 
-    norm = 1.0/255;
+/* queues a filled slot for the encoder thread */
 
-    Ey = (0.299*r + 0.587*g + 0.114*b)*norm;
-    Ecr = 0.713 * (r*norm - Ey);
-    Ecb = 0.564 * (b*norm - Ey);
+static void ring_publish(sg_video *v, int slot)
+{
+    v->ring_pts[slot] = v->i_frame;
 
+    pthread_mutex_lock(&v->ring_lock);
+    v->ring_head = (slot + 1) % v->nring;
+    v->ring_count++;
+    pthread_cond_signal(&v->ring_filled);
+    pthread_mutex_unlock(&v->ring_lock);
+}
 
-    *y = Ey * 255;
-    *u = (0.5 + Ecb) * 255;
-    *v = (0.5 + Ecr) * 255;
+static void lin_decode_row(void *ud, int y, int thread)
+{
+    sg_video *v;
+    v = ud;
+    sg_lin_decode(&v->cairo_buf[y * v->width],
+                  &v->linbuf[(size_t)y * v->width * 4],
+                  v->width);
+}
+
+static void lin_encode_row(void *ud, int y, int thread)
+{
+    sg_video *v;
+    v = ud;
+    sg_lin_encode(&v->linbuf[(size_t)y * v->width * 4],
+                  &v->cairo_buf[y * v->width],
+                  v->width);
 }
 
-/* yuv function designed to be applied to cairo surfaces
- * This assumes the format is CAIRO_FORMAT_RGB24
+/*
+ * Linear light mode. While it is on, stencils, text, fbm,
+ * images and unshade transfers composite in a 16-bit linear
+ * premultiplied copy of the frame, which goes back to sRGB
+ * once per frame in sg_video_append. Cairo keeps drawing in
+ * sRGB into its own buffer, so switch the mode off before
+ * drawing with cairo and back on afterwards. sg_video_set,
+ * sg_video_get and sg_video_write_png go through the linear
+ * copy while the mode is on.
  */
 
-void cairo2yuv(uint32_t *pix,
-               unsigned int w, unsigned int h,
-               uint8_t *ybuf,
-               uint8_t *ubuf,
-               uint8_t *vbuf)
+void sg_video_linear(sg_video *v, int on)
 {
-    unsigned int x, y;
-    unsigned int pos;
-    /* unsigned int posB; */
-    uint8_t yv, uv, vv;
-    unsigned char r, g, b;
-    uint32_t tmp;
-
-    pos = 0;
-    /* posB = 0; */
-    for(y = 0; y < h; y++) {
-        for(x = 0; x < w; x++) {
-            tmp = pix[y * w + x];
-
-            b = tmp & 0xff;
-            g = (tmp >> 8) & 0xff;
-            r = (tmp >> 16) & 0xff;
-            rgb2yuv(r, g, b, &yv, &uv, &vv);
-            ybuf[pos] = yv;
-            /* if(x % 2 == 0 && y % 2 == 0) { */
-            /*     ubuf[posB] = uv; */
-            /*     vbuf[posB] = vv; */
-            /*     posB++; */
-            /* } */
-            ubuf[pos] = uv;
-            vbuf[pos] = vv;
-
-            pos++;
+    if (v->cairo_buf == NULL) return;
+
+    on = on != 0;
+    if (on == v->linear) return;
+
+    if (on) {
+        if (v->linbuf == NULL) {
+            v->linbuf = malloc(sizeof(uint16_t) * 4 *
+                               (size_t)v->width * v->height);
+            if (v->linbuf == NULL) {
+                fprintf(stderr, "Could not allocate the linear frame\n");
+                return;
+            }
         }
+        sg_pool_run(sg_pool_global(), v->height, lin_decode_row, v);
+    } else {
+        sg_pool_run(sg_pool_global(), v->height, lin_encode_row, v);
     }
+
+    v->linear = on;
 }
 
 void sg_video_append(sg_video *v)
 {
-    int i_frame_size;
-
-    cairo2yuv(v->cairo_buf,
-              v->width, v->height,
-              v->pic.img.plane[0],
-              v->pic.img.plane[1],
-              v->pic.img.plane[2]);
-
-    v->pic.i_pts = v->i_frame;
-
-    v->i_frame++;
+    if (v->h == NULL) return;
 
+    if (v->linear) {
+        sg_pool_run(sg_pool_global(), v->height, lin_encode_row, v);
+    }
 
-    i_frame_size = x264_encoder_encode(v->h,
-                                       &v->nal,
-                                       &v->i_nal,
-                                       &v->pic,
-                                       &v->pic_out);
+    if (v->nring > 0) {
+        int slot;
 
-    if(i_frame_size < 0) return;
-    else if(i_frame_size) {
-        fwrite(v->nal->p_payload, i_frame_size, 1, v->fp);
+        slot = ring_acquire(v);
+        memcpy(v->ring[slot], v->cairo_buf, v->stride * v->height);
+        ring_publish(v, slot);
+    } else {
+        convert_frame(v, v->cairo_buf);
+        encode_frame(v, v->i_frame);
     }
+
+    v->i_frame++;
 }
 
 void sg_video_close(sg_video *v)
@@ -264,8 +757,16 @@ void sg_video_close(sg_video *v)
         v->cairo_buf = NULL;
     }
 
+    if (v->linbuf != NULL) {
+        free(v->linbuf);
+        v->linbuf = NULL;
+        v->linear = 0;
+    }
+
     /* x264 cleanup */
-    if (v->fp != NULL) {
+    if (v->nring > 0) pipeline_stop(v);
+
+    if (v->h != NULL) {
         int i_frame_size;
         while (x264_encoder_delayed_frames(v->h)) {
             i_frame_size = x264_encoder_encode(
@@ -274,16 +775,17 @@ void sg_video_close(sg_video *v)
                 &v->i_nal,
                 NULL,
                 &v->pic_out);
-            if (i_frame_size) {
-                fwrite(v->nal->p_payload,
-                       i_frame_size,
-                       1,
-                       v->fp);
-            }
+            write_frame(v, i_frame_size);
         }
 
         x264_encoder_close(v->h);
         x264_picture_clean(&v->pic);
+        v->h = NULL;
+    }
+
+    if (v->mp4 != NULL) sg_mp4_del(&v->mp4);
+
+    if (v->fp != NULL) {
         free(v->ybuf);
         free(v->ubuf);
         free(v->vbuf);
@@ -297,12 +799,27 @@ void sg_video_close(sg_video *v)
         v->fs = NULL;
     }
 
+    sg_textcache_del(&v->textcache);
+
     /* unshade cleanup */
 
     if (v->usbuf != NULL) {
         free(v->usbuf);
         v->usbuf = NULL;
     }
+
+    if (v->usmem != NULL) {
+        free(v->usmem);
+        v->usmem = NULL;
+    }
+
+    if (v->fbmbuf != NULL) {
+        free(v->fbmbuf);
+        v->fbmbuf = NULL;
+        v->fbmbuf_size = 0;
+    }
+
+    sg_fbm_field_del(&v->fbmfield);
 }
 
 void sg_video_color(sg_video *v,
@@ -395,10 +912,55 @@ void sg_video_text_extents(sg_video *v,
     e->y_advance = ce.y_advance;
 }
 
+/*
+ * (Re)builds the premultiplied copy used by the alpha blits,
+ * with the runs of each row that are not fully transparent
+ * stored in runs, and rowruns[y] to rowruns[y + 1] giving
+ * the runs of row y. The rows are counted first, so runs
+ * holds exactly as many as the image has.
+ */
+
+static void image_index(sg_image *img)
+{
+    unsigned int y;
+    int l;
+    int nruns;
+
+    for (l = 0; l < img->nmips; l++) free(img->mips[l]);
+    free(img->mips);
+    img->mips = NULL;
+    img->nmips = 0;
+
+    if (img->pm == NULL) {
+        img->pm = malloc(sizeof(uint32_t) * img->w * img->h);
+        img->rowruns = malloc(sizeof(int) * (img->h + 1));
+    }
+
+    sg_blit_premultiply(img->img, img->pm, img->w * img->h);
+
+    img->rowruns[0] = 0;
+
+    for (y = 0; y < img->h; y++) {
+        img->rowruns[y + 1] = img->rowruns[y] +
+            sg_blit_runs(&img->pm[y * img->w], img->w, NULL);
+    }
+
+    nruns = img->rowruns[img->h];
+
+    free(img->runs);
+    img->runs = malloc(sizeof(int) * 2 * (nruns > 0 ? nruns : 1));
+
+    for (y = 0; y < img->h; y++) {
+        sg_blit_runs(&img->pm[y * img->w], img->w,
+                     &img->runs[2 * img->rowruns[y]]);
+    }
+}
+
 int sg_image_new(sg_image **pimg, const char *filename)
 {
     sg_image *img;
     int rc;
+    unsigned int n, p;
     img = calloc(1, sizeof(sg_image));
 
     rc = lodepng_decode32_file(&img->img,
@@ -410,8 +972,23 @@ int sg_image_new(sg_image **pimg, const char *filename)
                 "error %u: %s\n",
                 rc,
                 lodepng_error_text(rc));
+        free(img);
         return 0;
     }
+
+    /* opaque copy in the frame's own pixel layout, for sg_video_image */
+    n = img->w * img->h;
+    img->argb = malloc(sizeof(uint32_t) * n);
+
+    for (p = 0; p < n; p++) {
+        img->argb[p] = 0xff000000 |
+            img->img[4*p] << 16 |
+            img->img[4*p + 1] << 8 |
+            img->img[4*p + 2];
+    }
+
+    image_index(img);
+
     *pimg = img;
 
     return 1;
@@ -426,273 +1003,918 @@ void sg_image_dims(sg_image *i, int *w, int *h)
 void sg_image_del(sg_image **pimg)
 {
     sg_image *img;
+    int p;
 
     img = *pimg;
 
+    for (p = 0; p < img->nmips; p++) free(img->mips[p]);
+    free(img->mips);
+    free(img->rowsegs);
+    free(img->segs);
+    free(img->cov);
+    free(img->rowruns);
+    free(img->runs);
+    free(img->pm);
+    free(img->argb);
     free(img->img);
     free(img);
 }
 
-/* transfers lodepng image RGBA block to cairo ARGB block */
+/*
+ * Clips a blit of a w by h image at (x_pos, y_pos) to the
+ * frame. Columns x0 to x1 and rows y0 to y1 of the image
+ * are left, placed with its corner at (ix, iy). Returns 0
+ * when none of it is on screen.
+ */
+
+typedef struct {
+    int ix, iy;
+    int x0, y0;
+    int x1, y1;
+} blit_rect;
+
+static int clip_blit(sg_video *v,
+                     float x_pos, float y_pos,
+                     int w, int h,
+                     blit_rect *r)
+{
+    r->ix = floor(x_pos);
+    r->iy = floor(y_pos);
+
+    r->x0 = r->ix < 0 ? -r->ix : 0;
+    r->y0 = r->iy < 0 ? -r->iy : 0;
+    r->x1 = w;
+    r->y1 = h;
+    if (r->ix + r->x1 > v->width) r->x1 = v->width - r->ix;
+    if (r->iy + r->y1 > v->height) r->y1 = v->height - r->iy;
+
+    return r->x0 < r->x1 && r->y0 < r->y1;
+}
+
+/* opaque image blit, one memcpy per row */
 
 void sg_video_image(sg_video *v,
                     sg_image *i,
                     float x_pos,
                     float y_pos)
 {
+    blit_rect r;
+    int y;
+
+    if (!clip_blit(v, x_pos, y_pos, i->w, i->h, &r)) return;
+
+    for (y = r.y0; y < r.y1; y++) {
+        size_t pos;
+        const uint32_t *src;
+
+        pos = (size_t)v->width * (r.iy + y) + r.ix + r.x0;
+        src = &i->argb[y * i->w + r.x0];
+
+        if (v->linear) {
+            sg_lin_decode(src, &v->linbuf[pos * 4], r.x1 - r.x0);
+        } else {
+            memcpy(&v->cairo_buf[pos], src, sizeof(uint32_t) * (r.x1 - r.x0));
+        }
+    }
+}
+
+void sg_fbm_n(const float *x, const float *y, float *out, int n, int oct);
+
+struct fbmjob {
+    sg_video *v;
+    uint32_t clr;
+    int noct;
+    float t;
+
+    /* sample grid: cw by ch samples, div pixels apart */
+    int div;
+    int cw, ch;
+
+    /* sampled field, when drawing below full resolution */
+    float *field;
+
+    /* cached qy term over the sample grid */
+    sg_fbm_field *f;
+};
+
+/* fbm domain coordinates of the n pixels x, x + step, ... of row y */
+
+static void fbm_coords(sg_video *v, int x, int y, int step, int n,
+                       float *xn, float *yn)
+{
+    int i;
+    float iw, ih;
+
+    iw = 1.0 / v->width;
+    ih = 1.0 / v->height;
+
+    for (i = 0; i < n; i++) {
+        xn[i] = (float)(x + i * step) * iw;
+        yn[i] = (float)y * ih;
+        xn[i] = xn[i] * ((float)v->width * ih);
+
+        xn[i] *= 4.f;
+        yn[i] *= 4.f;
+    }
+}
+
+/*
+ * Frame alpha at the n pixels x, x + step, ... of row y. Each
+ * of the fbm terms is evaluated for the whole span, so the
+ * noise underneath runs batched. qy is the time-invariant
+ * term, already computed. n is at most 64.
+ */
+
+static void fbm_span(struct fbmjob *s, int x, int y, int step, int n,
+                     const float *qy, float *alpha)
+{
+    int i;
+    int noct;
+    float t;
+    float xn[64], yn[64];
+    float px[64], py[64];
+    float qx[64];
+    float rx[64], ry[64];
+
+    noct = s->noct;
+    t = s->t;
+
+    fbm_coords(s->v, x, y, step, n, xn, yn);
+
+    for (i = 0; i < n; i++) {
+        px[i] = xn[i] + t;
+        py[i] = yn[i] + t;
+    }
+    sg_fbm_n(px, py, qx, n, noct);
+
+    for (i = 0; i < n; i++) {
+        px[i] = xn[i] + qx[i] + 1.7f + (t * 0.15f);
+        py[i] = yn[i] + qy[i] + 9.2f + (t * 0.15f);
+    }
+    sg_fbm_n(px, py, rx, n, noct);
+
+    for (i = 0; i < n; i++) {
+        px[i] = xn[i] + qx[i] + 8.3f + (t * 0.126f);
+        py[i] = yn[i] + qy[i] + 2.8f + (t * 0.3f);
+    }
+    sg_fbm_n(px, py, ry, n, noct);
+
+    for (i = 0; i < n; i++) {
+        px[i] = xn[i] + rx[i];
+        py[i] = yn[i] + ry[i];
+    }
+    sg_fbm_n(px, py, alpha, n, noct);
+
+    for (i = 0; i < n; i++) {
+        float a;
+
+        a = alpha[i];
+
+        /* clamp! */
+        if (a < 0) a = 0;
+        if (a > 1) a = 1;
+
+        /* a of 0 is all fbm color, 1 leaves the frame */
+        alpha[i] = 1 - a;
+    }
+}
+
+static void fbm_blend(sg_video *v, int x, int y, int n,
+                      uint32_t clr, const float *alpha)
+{
+    if (v->linear) {
+        sg_lin_span(&v->linbuf[((size_t)y * v->width + x) * 4],
+                    n, clr, alpha, 1);
+    } else {
+        sg_colorlerp_span(&v->cairo_buf[(size_t)y * v->width + x],
+                          n, clr, alpha, 1);
+    }
+}
+
+/* one row of the qy term over the sample grid */
+
+static void qy_row(void *ud, int cy, int thread)
+{
+    int cx, i, n;
+    struct fbmjob *s;
+    float xn[64], yn[64];
+
+    s = ud;
+
+    for (cx = 0; cx < s->cw; cx += n) {
+        n = s->cw - cx;
+        if (n > 64) n = 64;
+
+        fbm_coords(s->v, cx * s->div, cy * s->div, s->div, n, xn, yn);
+
+        for (i = 0; i < n; i++) {
+            xn[i] += 2.f;
+            yn[i] += 1.f;
+        }
+
+        sg_fbm_n(xn, yn, &s->f->qy[(size_t)cy * s->cw + cx], n, s->noct);
+    }
+}
+
+/*
+ * One row of samples: into the field when drawing below full
+ * resolution, otherwise straight onto the frame.
+ */
+
+static void sample_row(void *ud, int cy, int thread)
+{
+    int cx, n;
+    struct fbmjob *s;
+    size_t pos;
+
+    s = ud;
+
+    for (cx = 0; cx < s->cw; cx += n) {
+        n = s->cw - cx;
+        if (n > 64) n = 64;
+
+        pos = (size_t)cy * s->cw + cx;
+
+        if (s->field != NULL) {
+            fbm_span(s, cx * s->div, cy * s->div, s->div, n,
+                     &s->f->qy[pos], &s->field[pos]);
+        } else {
+            float alpha[64];
+
+            fbm_span(s, cx, cy, 1, n, &s->f->qy[pos], alpha);
+            fbm_blend(s->v, cx, cy, n, s->clr, alpha);
+        }
+    }
+}
+
+/* bilinear upsampling of the field onto row y */
+
+static void upsample_row(void *ud, int y, int thread)
+{
+    int x, i, n;
+    struct fbmjob *s;
+    int div;
+    float fy;
+    const float *r0, *r1;
+    float alpha[64];
+
+    s = ud;
+    div = s->div;
+
+    r0 = &s->field[(size_t)(y / div) * s->cw];
+    r1 = r0 + s->cw;
+    fy = (float)(y % div) / div;
+
+    for (x = 0; x < s->v->width; x += n) {
+        n = s->v->width - x;
+        if (n > 64) n = 64;
+
+        for (i = 0; i < n; i++) {
+            int cx;
+            float fx;
+            float a0, a1;
+
+            cx = (x + i) / div;
+            fx = (float)((x + i) % div) / div;
+
+            a0 = r0[cx] + (r0[cx + 1] - r0[cx]) * fx;
+            a1 = r1[cx] + (r1[cx + 1] - r1[cx]) * fx;
+            alpha[i] = a0 + (a1 - a0) * fy;
+        }
+
+        fbm_blend(s->v, x, y, n, s->clr, alpha);
+    }
+}
+
+/*
+ * Precomputed fbm terms. qy does not depend on t, so it is
+ * computed once for a frame size, sample spacing and octave
+ * count, and reused by every frame drawn with the same ones.
+ */
+
+void sg_fbm_field_new(sg_fbm_field **pf)
+{
+    *pf = calloc(1, sizeof(sg_fbm_field));
+}
+
+void sg_fbm_field_del(sg_fbm_field **pf)
+{
+    if (*pf == NULL) return;
+
+    free((*pf)->qy);
+    free(*pf);
+    *pf = NULL;
+}
+
+/*
+ * Draws fbm using f for its time-invariant terms, filling it
+ * first if it was made for another size or octave count.
+ * Layers with different octave counts each keep their own.
+ */
+
+void sg_video_fbm_field(sg_video *v,
+                        int r, int g, int b,
+                        int noct, float t,
+                        sg_fbm_field *f)
+{
+    struct fbmjob s;
+    size_t sz;
+
+    s.v = v;
+    s.clr = (r & 0xff) << 16 | (g & 0xff) << 8 | (b & 0xff);
+    s.noct = noct;
+    s.t = t;
+    s.div = v->fbmdiv;
+    s.f = f;
+    s.field = NULL;
+
+    if (s.div <= 1) {
+        s.cw = v->width;
+        s.ch = v->height;
+    } else {
+        /* samples on every div-th pixel, plus one past each edge */
+        s.cw = (v->width - 1) / s.div + 2;
+        s.ch = (v->height - 1) / s.div + 2;
+    }
+
+    sz = (size_t)s.cw * s.ch;
+
+    if (f->qy == NULL ||
+        f->w != v->width || f->h != v->height ||
+        f->div != s.div || f->noct != noct) {
+        free(f->qy);
+        f->qy = malloc(sizeof(float) * sz);
+        f->w = v->width;
+        f->h = v->height;
+        f->div = s.div;
+        f->noct = noct;
+
+        sg_pool_run(sg_pool_global(), s.ch, qy_row, &s);
+    }
+
+    if (s.div <= 1) {
+        sg_pool_run(sg_pool_global(), s.ch, sample_row, &s);
+        return;
+    }
+
+    if (sz > v->fbmbuf_size) {
+        free(v->fbmbuf);
+        v->fbmbuf = malloc(sizeof(float) * sz);
+        v->fbmbuf_size = sz;
+    }
+
+    s.field = v->fbmbuf;
+
+    sg_pool_run(sg_pool_global(), s.ch, sample_row, &s);
+    sg_pool_run(sg_pool_global(), v->height, upsample_row, &s);
+}
+
+/* draws fbm through the video's own field */
+
+void sg_video_fbm(sg_video *v, int r, int g, int b, int noct, float t)
+{
+    if (v->fbmfield == NULL) sg_fbm_field_new(&v->fbmfield);
+    sg_video_fbm_field(v, r, g, b, noct, t, v->fbmfield);
+}
+
+/*
+ * Resolution of sg_video_fbm: the field is sampled every div
+ * pixels (1, 2 or 4) and bilinearly upsampled, which is close
+ * to div * div times cheaper. The field is smooth at these
+ * scales, but very high octave counts lose their finest
+ * detail.
+ */
+
+void sg_video_fbm_quality(sg_video *v, int div)
+{
+    if (div < 2) div = 1;
+    else if (div < 4) div = 2;
+    else div = 4;
+
+    v->fbmdiv = div;
+}
+
+/*
+ * Alpha blit of the sw by sh rectangle at sx, sy of an image:
+ * each pixel is composited by its own alpha times alpha,
+ * skipping the fully transparent runs.
+ */
+
+static void image_over(sg_video *v,
+                       sg_image *i,
+                       int sx, int sy,
+                       int sw, int sh,
+                       float x_pos,
+                       float y_pos,
+                       float alpha)
+{
+    blit_rect r;
+    int opacity;
+    int y;
+
+    if (!clip_blit(v, x_pos, y_pos, sw, sh, &r)) return;
+
+    if (alpha <= 0) return;
+    if (alpha > 1) alpha = 1;
+    opacity = alpha * 255 + 0.5f;
+
+    /* to image coordinates */
+    r.ix -= sx;
+    r.iy -= sy;
+    r.x0 += sx;
+    r.x1 += sx;
+    r.y0 += sy;
+    r.y1 += sy;
+
+    for (y = r.y0; y < r.y1; y++) {
+        int k;
+        size_t row;
+
+        row = (size_t)v->width * (r.iy + y) + r.ix;
+
+        for (k = i->rowruns[y]; k < i->rowruns[y + 1]; k++) {
+            int x0, x1;
+
+            x0 = i->runs[2*k];
+            x1 = i->runs[2*k + 1];
+            if (x0 < r.x0) x0 = r.x0;
+            if (x1 > r.x1) x1 = r.x1;
+            if (x0 >= x1) continue;
+
+            if (v->linear) {
+                sg_lin_over(&v->linbuf[(row + x0) * 4],
+                            &i->img[(y * i->w + x0) * 4],
+                            x1 - x0, alpha);
+            } else {
+                sg_blit_over(&v->cairo_buf[row + x0],
+                             &i->pm[y * i->w + x0],
+                             x1 - x0, opacity);
+            }
+        }
+    }
+}
+
+void sg_video_image_over(sg_video *v,
+                         sg_image *i,
+                         float x_pos,
+                         float y_pos,
+                         float alpha)
+{
+    image_over(v, i, 0, 0, i->w, i->h, x_pos, y_pos, alpha);
+}
+
+/*
+ * Mipmap level of an image, level 0 being the premultiplied
+ * copy itself. Levels are built as far as asked the first
+ * time, and asking past the last (1 by 1) level gives it.
+ */
+
+static const uint32_t * image_mip(sg_image *img, int level, int *w, int *h)
+{
+    const uint32_t *src;
+    int l;
+
+    src = img->pm;
+    *w = img->w;
+    *h = img->h;
+
+    for (l = 1; l <= level; l++) {
+        int dw, dh;
+
+        if (*w == 1 && *h == 1) break;
+
+        dw = *w > 1 ? *w / 2 : 1;
+        dh = *h > 1 ? *h / 2 : 1;
+
+        if (l > img->nmips) {
+            img->mips = realloc(img->mips, sizeof(uint32_t *) * l);
+            img->mips[l - 1] = malloc(sizeof(uint32_t) * dw * dh);
+            sg_blit_halve(src, *w, *h, img->mips[l - 1]);
+            img->nmips = l;
+        }
+
+        src = img->mips[l - 1];
+        *w = dw;
+        *h = dh;
+    }
+
+    return src;
+}
+
+struct drawjob {
+    sg_video *v;
+    const uint32_t *src;
+    int sw, sh;
+    int x0, x1;
+    int y0;
+
+    /* texel coordinates at the frame origin, and their steps */
+    double u, du_dx, du_dy;
+    double t, dt_dx, dt_dy;
+
+    float alpha;
+    int opacity;
+};
+
+static int64_t fixed16(double x)
+{
+    return floor(x * 65536.0 + 0.5);
+}
+
+/* floor(a / d) for d > 0 */
+
+static int64_t floordiv(int64_t a, int64_t d)
+{
+    return a >= 0 ? a / d : -((d - 1 - a) / d);
+}
+
+/*
+ * Narrows the samples k0 <= k < k1 at p + k * dp, in 16.16,
+ * to the ones whose texel is -1 to size - 1. The rest sample
+ * nothing but transparent texels.
+ */
+
+static void clip_samples(int64_t p, int64_t dp, int size, int *k0, int *k1)
+{
+    int64_t lo, hi;
+    int64_t a, b;
+
+    lo = -65536;
+    hi = (int64_t)size << 16;
+
+    if (dp == 0) {
+        if (p < lo || p >= hi) *k1 = *k0;
+        return;
+    }
+
+    /* lo <= p + k * dp < hi */
+    if (dp > 0) {
+        a = -floordiv(p - lo, dp);
+        b = -floordiv(p - hi, dp);
+    } else {
+        a = floordiv(p - hi, -dp) + 1;
+        b = floordiv(p - lo, -dp) + 1;
+    }
+
+    if (a > *k0) *k0 = a < *k1 ? a : *k1;
+    if (b < *k1) *k1 = b > *k0 ? b : *k0;
+}
+
+static void draw_row(void *ud, int task, int thread)
+{
+    struct drawjob *d;
+    uint32_t px[64];
+    sg_video *v;
+    int x, y;
+
+    d = ud;
+    v = d->v;
+    y = d->y0 + task;
+
+    for (x = d->x0; x < d->x1; x += 64) {
+        int k0, k1, n;
+        int64_t u, t, du, dt;
+        size_t pos;
+
+        k0 = 0;
+        k1 = d->x1 - x;
+        if (k1 > 64) k1 = 64;
 
-    int width;
-    int height;
-    int x, y;
-    unsigned int ix, iy;
-    uint32_t *cairo_buf;
-    unsigned char *img_buf;
-    uint32_t val;
-    unsigned int pos;
+        u = fixed16(d->u + (x + 0.5) * d->du_dx + (y + 0.5) * d->du_dy);
+        t = fixed16(d->t + (x + 0.5) * d->dt_dx + (y + 0.5) * d->dt_dy);
+        du = fixed16(d->du_dx);
+        dt = fixed16(d->dt_dx);
 
-    width = i->w;
-    height = i->h;
+        /* only samples on the image, so the 16.16 steps can't wrap */
+        clip_samples(u, du, d->sw, &k0, &k1);
+        clip_samples(t, dt, d->sh, &k0, &k1);
 
-    cairo_buf = v->cairo_buf;
-    img_buf = i->img;
-
-    ix = (unsigned int)x_pos;
-    iy = (unsigned int)y_pos;
-    /* printf(">>ix %d, iy %d\n", ix, iy); */
-
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-            pos = (y * i->w * 4) + x * 4;
-            val = 0;
-
-            /* blue */
-            val |= img_buf[pos + 2];
-            /* green */
-            val |= (img_buf[pos + 1] << 8);
-            /* red */
-            val |= (img_buf[pos] << 16);
-
-            /* TODO: handle transparency */
-            val |= 255 << 24;
-
-            /* pos = v->stride * (iy + y) + x; */
-            pos = v->width * (iy + y) + (ix + x);
-            cairo_buf[pos] = val;
+        n = k1 - k0;
+        if (n <= 0) continue;
+
+        u += k0 * du;
+        t += k0 * dt;
+        if (n == 1) du = dt = 0;
+
+        sg_blit_sample(px, d->src, d->sw, d->sh, u, t, du, dt, n);
+
+        pos = (size_t)y * v->width + x + k0;
+
+        if (v->linear) {
+            sg_lin_over_pm(&v->linbuf[pos * 4], px, n, d->alpha);
+        } else {
+            sg_blit_over(&v->cairo_buf[pos], px, n, d->opacity);
         }
     }
 }
 
-static void getpixel(sg_video *v, int x, int y,
-                     uint8_t *r, uint8_t *g, uint8_t *b)
+/*
+ * Draws an image scaled by sx, sy and rotated by angle
+ * (radians), its center landing at x, y. Sampling is
+ * bilinear, from a mipmap level when shrinking by half or
+ * more. Rows are drawn on the thread pool.
+ */
+
+void sg_video_image_draw(sg_video *v,
+                         sg_image *i,
+                         float x, float y,
+                         float sx, float sy,
+                         float angle,
+                         float alpha)
 {
-    int bufpos;
-    uint32_t clr;
+    struct drawjob d;
+    double c, s;
+    double hw, hh;
+    double ex, ey;
+    double scale, ratio;
+    int level;
+    int y1;
+
+    if (sx == 0 || sy == 0 || alpha <= 0) return;
+    if (alpha > 1) alpha = 1;
+
+    c = cos(angle);
+    s = sin(angle);
+
+    /* bounding box of the corners, plus a texel of fade out */
+    hw = i->w * 0.5;
+    hh = i->h * 0.5;
+    ex = fabs(c * sx) * (hw + 1) + fabs(s * sy) * (hh + 1);
+    ey = fabs(s * sx) * (hw + 1) + fabs(c * sy) * (hh + 1);
+
+    d.x0 = floor(x - ex);
+    d.x1 = ceil(x + ex);
+    d.y0 = floor(y - ey);
+    y1 = ceil(y + ey);
+    if (d.x0 < 0) d.x0 = 0;
+    if (d.y0 < 0) d.y0 = 0;
+    if (d.x1 > v->width) d.x1 = v->width;
+    if (y1 > v->height) y1 = v->height;
+    if (d.x0 >= d.x1 || d.y0 >= y1) return;
+
+    level = 0;
+    scale = sqrt(fabs(sx * sy));
+    while (scale <= 0.5) {
+        scale *= 2;
+        level++;
+    }
 
-    *r = *g = *b = 0;
+    d.src = image_mip(i, level, &d.sw, &d.sh);
 
-    bufpos = v->width * y + x;
-    clr = v->cairo_buf[bufpos];
-    *r = (clr >> 16) & 0xff;
-    *g = (clr >> 8) & 0xff;
-    *b = (clr) & 0xff;
-}
+    if (d.sw > 32767 || d.sh > 32767) {
+        fprintf(stderr, "Image is too large to draw transformed\n");
+        return;
+    }
 
-static void setpixel(sg_video *v, int x, int y,
-                     uint8_t r, uint8_t g, uint8_t b)
-{
-    uint32_t clr;
-    int bufpos;
+    /*
+     * frame to image: rotate back by angle about x, y, unscale,
+     * then move to texel centers of the level
+     */
+    ratio = (double)d.sw / i->w;
+    d.du_dx = c / sx * ratio;
+    d.du_dy = s / sx * ratio;
+    d.u = (hw - x * d.du_dx / ratio - y * d.du_dy / ratio) * ratio - 0.5;
 
-    clr = 0;
-    bufpos = v->width * y + x;
+    ratio = (double)d.sh / i->h;
+    d.dt_dx = -s / sy * ratio;
+    d.dt_dy = c / sy * ratio;
+    d.t = (hh - x * d.dt_dx / ratio - y * d.dt_dy / ratio) * ratio - 0.5;
 
-    clr |= b;
-    clr |= (g << 8);
-    clr |= (r << 16);
-    clr |= 255 << 24;
+    d.v = v;
+    d.alpha = alpha;
+    d.opacity = alpha * 255 + 0.5f;
 
-    v->cairo_buf[bufpos] = clr;
+    sg_pool_run(sg_pool_global(), y1 - d.y0, draw_row, &d);
 }
 
-float sg_fbm(float x, float y, int oct);
-
-struct fbmstrip {
-    sg_video *v;
-    int r, g, b;
-    int noct;
-    float t;
-    int yoff;
-    int size;
-};
+/*
+ * Texture atlas: many small images packed into one, drawn by
+ * id. The alpha blit index is rebuilt on the first draw after
+ * images are added.
+ */
 
-static void *render_strip(void *ptr)
+void sg_atlas_new(sg_atlas **pa, int w, int h)
 {
-    int x, y;
-    sg_video *v;
-    int r, g, b, noct;
-    float t;
-    float iw, ih;
-    struct fbmstrip *s;
+    sg_atlas *a;
 
-    s = ptr;
-    v = s->v;
-    r = s->r;
-    g = s->g;
-    b = s->b;
-    noct = s->noct;
-    t = s->t;
+    a = calloc(1, sizeof(sg_atlas));
+    a->img = calloc(1, sizeof(sg_image));
+    a->img->w = w;
+    a->img->h = h;
+    a->img->img = calloc((size_t)w * h, 4);
+    sg_skyline_new(&a->sky, w, h);
 
-    iw = 1.0 / v->width;
-    ih = 1.0 / v->height;
+    *pa = a;
+}
 
-    for (y = 0; y < s->size; y++) {
-        for (x = 0; x < v->width; x++) {
-            uint8_t clr[3];
-            float xn, yn;
-            float qx, qy;
-            float rx, ry;
-            float a;
-            int ypos;
+void sg_atlas_del(sg_atlas **pa)
+{
+    sg_atlas *a;
 
-            ypos = y + s->yoff;
+    if (*pa == NULL) return;
 
-            xn = (float)x * iw;
-            yn = (float)(ypos) * ih;
-            xn = xn * ((float)v->width * ih);
+    a = *pa;
+    sg_skyline_del(&a->sky);
+    sg_image_del(&a->img);
+    free(a->rects);
+    free(a);
+    *pa = NULL;
+}
 
-            xn *= 4.f;
-            yn *= 4.f;
+/*
+ * Adds a PNG to the atlas. Returns its id, or -1 if it
+ * could not be loaded or there is no room left.
+ */
 
-            qx = sg_fbm(xn + t, yn + t, noct);
-            qy = sg_fbm(xn + 2.f, yn + 1.f, noct);
+int sg_atlas_add(sg_atlas *a, const char *filename)
+{
+    unsigned char *px;
+    unsigned int w, h;
+    unsigned int y;
+    int rx, ry;
+    int rc;
+    int *rect;
 
-            rx = sg_fbm(xn + qx + 1.7f + (t * 0.15f),
-                        yn + qy + 9.2f + (t * 0.15f),
-                        noct);
+    rc = lodepng_decode32_file(&px, &w, &h, filename);
+    if (rc) {
+        fprintf(stderr,
+                "error %u: %s\n",
+                rc,
+                lodepng_error_text(rc));
+        return -1;
+    }
 
-            ry = sg_fbm(xn + qx + 8.3f + (t * 0.126f),
-                        yn + qy + 2.8f + (t * 0.3f),
-                        noct);
+    if (!sg_skyline_add(a->sky, w, h, &rx, &ry)) {
+        fprintf(stderr, "atlas full, could not add %s\n", filename);
+        free(px);
+        return -1;
+    }
 
-            a = sg_fbm(xn + rx, yn + ry, noct);
+    for (y = 0; y < h; y++) {
+        memcpy(&a->img->img[((ry + y) * a->img->w + rx) * 4],
+               &px[y * w * 4],
+               w * 4);
+    }
 
-            /* clamp! */
-            if (a < 0) a = 0;
-            if (a > 1) a = 1;
+    free(px);
 
-            getpixel(v, x, ypos, &clr[0], &clr[1], &clr[2]);
-            sg_colorlerp(r, g, b,
-                         clr[0], clr[1], clr[2], a,
-                         &clr[0], &clr[1], &clr[2]);
-            setpixel(v, x, ypos, clr[0], clr[1], clr[2]);
-        }
+    if (a->nrects == a->crects) {
+        a->crects = a->crects ? a->crects * 2 : 16;
+        a->rects = realloc(a->rects, sizeof(int) * 4 * a->crects);
     }
 
-    return NULL;
-}
+    rect = &a->rects[4 * a->nrects];
+    rect[0] = rx;
+    rect[1] = ry;
+    rect[2] = w;
+    rect[3] = h;
 
-#define NTHREADS 8
+    a->dirty = 1;
 
-void sg_video_fbm(sg_video *v, int r, int g, int b, int noct, float t)
+    return a->nrects++;
+}
+
+int sg_atlas_dims(sg_atlas *a, int id, int *w, int *h)
 {
-    struct fbmstrip s[NTHREADS];
-    pthread_t th[NTHREADS];
-    int size;
-    int i;
+    if (id < 0 || id >= a->nrects) return 0;
 
-    size = v->height / NTHREADS;
+    *w = a->rects[4*id + 2];
+    *h = a->rects[4*id + 3];
 
-    for (i = 0; i < NTHREADS; i++) {
-        s[i].v = v;
-        s[i].r = r;
-        s[i].g = g;
-        s[i].b = b;
-        s[i].noct = noct;
-        s[i].t = t;
-        s[i].size = size;
-        s[i].yoff = i * size;
-    }
+    return 1;
+}
 
-    for (i = 0; i < NTHREADS; i++) {
-        pthread_create(&th[i], NULL, render_strip, &s[i]);
-    }
-    for (i = 0; i < NTHREADS; i++) {
-        pthread_join(th[i], NULL);
+void sg_video_atlas(sg_video *v,
+                    sg_atlas *a,
+                    int id,
+                    float x_pos,
+                    float y_pos,
+                    float alpha)
+{
+    int *rect;
+
+    if (id < 0 || id >= a->nrects) return;
+
+    if (a->dirty) {
+        image_index(a->img);
+        a->dirty = 0;
     }
 
-    /* for (i = 0; i < NTHREADS; i++) { */
-    /*     render_strip((void *)&s[i]); */
-    /* } */
+    rect = &a->rects[4 * id];
+    image_over(v, a->img,
+               rect[0], rect[1], rect[2], rect[3],
+               x_pos, y_pos, alpha);
 }
 
-#undef NTHREADS
-
 void sg_video_image_withalpha(sg_video *v,
                               sg_image *i,
                               float x_pos,
                               float y_pos,
                               float alpha)
 {
+    blit_rect r;
+    int y;
+    int n;
+
+    if (!clip_blit(v, x_pos, y_pos, i->w, i->h, &r)) return;
+
+    n = r.x1 - r.x0;
+
+    if (v->linear) {
+        if ((size_t)n > v->linrow_size) {
+            free(v->linrow);
+            v->linrow = malloc(sizeof(uint16_t) * 4 * n);
+            if (v->linrow == NULL) {
+                v->linrow_size = 0;
+                fprintf(stderr, "Could not allocate an image row\n");
+                return;
+            }
+            v->linrow_size = n;
+        }
 
-    int width;
-    int height;
-    int x, y;
-    unsigned int ix, iy;
-    uint32_t *cairo_buf;
-    unsigned char *img_buf;
-    uint32_t val;
-    unsigned int imgpos, bufpos;
+        for (y = r.y0; y < r.y1; y++) {
+            size_t pos;
+            pos = (size_t)v->width * (r.iy + y) + r.ix + r.x0;
+            sg_lin_decode(&i->argb[y * i->w + r.x0], v->linrow, n);
+            sg_lin_mix(&v->linbuf[pos * 4], v->linrow, n, alpha);
+        }
+        return;
+    }
 
-    width = i->w;
-    height = i->h;
+    for (y = r.y0; y < r.y1; y++) {
+        sg_colorlerp_mix(&v->cairo_buf[(size_t)v->width * (r.iy + y) +
+                                       r.ix + r.x0],
+                         &i->argb[y * i->w + r.x0],
+                         n, alpha);
+    }
+}
 
-    cairo_buf = v->cairo_buf;
-    img_buf = i->img;
+/*
+ * Builds the stencil mask of an image: its red channel as
+ * 8-bit coverage, cut into runs that are either solid (255)
+ * or edges (anything else), with the empty gaps left out.
+ */
 
-    ix = (unsigned int)x_pos;
-    iy = (unsigned int)y_pos;
+static void image_mask(sg_image *img)
+{
+    unsigned int x, y;
+    int nsegs, csegs;
 
-    /* printf("ix %d, iy %d\n", ix, iy); */
+    img->cov = malloc(img->w * img->h);
+    img->rowsegs = malloc(sizeof(int) * (img->h + 1));
 
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-            uint8_t in[3];
-            uint8_t out[3];
-            uint8_t rgb[3];
-            uint32_t clr;
+    for (x = 0; x < img->w * img->h; x++) {
+        img->cov[x] = img->img[4*x];
+    }
+
+    nsegs = 0;
+    csegs = img->h * 2;
+    img->segs = malloc(sizeof(int) * 3 * csegs);
 
-            bufpos = v->width * (iy + y) + (ix + x);
-            imgpos = (y * i->w * 4) + x * 4;
-            val = 0;
+    for (y = 0; y < img->h; y++) {
+        const uint8_t *row;
 
-            clr = cairo_buf[bufpos];
+        row = &img->cov[y * img->w];
+        img->rowsegs[y] = nsegs;
+        x = 0;
 
-            in[0] = (clr >> 16) & 0xff;
-            in[1] = (clr >> 8) & 0xff;
-            in[2] = (clr) & 0xff;
+        while (x < img->w) {
+            int solid;
+            int *seg;
 
-            out[0] = img_buf[imgpos];
-            out[1] = img_buf[imgpos + 1];
-            out[2] = img_buf[imgpos + 2];
+            if (row[x] == 0) {
+                x++;
+                continue;
+            }
 
-            sg_colorlerp_lin(in[0], in[1], in[2], out[0], out[1], out[2], alpha,
-                         &rgb[0], &rgb[1], &rgb[2]);
+            if (nsegs == csegs) {
+                csegs *= 2;
+                img->segs = realloc(img->segs, sizeof(int) * 3 * csegs);
+            }
 
-            /* blue */
-            val |= rgb[2];
-            /* green */
-            val |= (rgb[1] << 8);
-            /* red */
-            val |= (rgb[0] << 16);
+            seg = &img->segs[3 * nsegs];
+            solid = row[x] == 255;
+            seg[0] = x;
+            seg[2] = solid;
 
-            val |= 255 << 24;
+            while (x < img->w && row[x] != 0 && (row[x] == 255) == solid) {
+                x++;
+            }
 
-            /* pos = v->stride * (iy + y) + x; */
-            cairo_buf[bufpos] = val;
+            seg[1] = x;
+            nsegs++;
         }
     }
+
+    img->rowsegs[img->h] = nsegs;
 }
 
+/*
+ * Fills the image's red channel as a mask with a solid
+ * color: empty runs are skipped, solid ones filled and only
+ * the edges blended per pixel.
+ */
+
 void sg_video_stencil(sg_video *v,
                       sg_image *i,
                       float x_pos,
@@ -700,64 +1922,52 @@ void sg_video_stencil(sg_video *v,
                       int r, int g, int b,
                       double alpha)
 {
-
-    int width;
-    int height;
-    int x, y;
-    unsigned int ix, iy;
-    uint32_t *cairo_buf;
-    unsigned char *img_buf;
-    uint32_t val;
-    unsigned int pos;
+    blit_rect br;
+    int y;
     uint32_t clr;
-    uint8_t bg[3];
-    uint8_t rgb[3];
-    double oned255;
-
-    width = i->w;
-    height = i->h;
-
-    cairo_buf = v->cairo_buf;
-    img_buf = i->img;
-
-    ix = (unsigned int)x_pos;
-    iy = (unsigned int)y_pos;
-
-    oned255 = 1.0/255.0;
-
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-            double amt;
-            pos = (y * i->w * 4) + x * 4;
-            val = 0;
-
-            amt = img_buf[pos] * oned255 * alpha;
-
-            pos = v->width * (iy + y) + (ix + x);
-            clr = cairo_buf[pos];
-
-            bg[0] = (clr >> 16) & 0xff;
-            bg[1] = (clr >> 8) & 0xff;
-            bg[2] = (clr) & 0xff;
-
-
-            /* rgb[0] = floor(amt * r + (1 - amt) * bg[0]); */
-            /* rgb[1] = floor(amt * g + (1 - amt) * bg[1]); */
-            /* rgb[2] = floor(amt * b + (1 - amt) * bg[2]); */
-
-            sg_colorlerp(bg[0], bg[1], bg[2], r, g, b, amt,
-                         &rgb[0], &rgb[1], &rgb[2]);
-
-            /* blue */
-            val |= rgb[2];
-            /* green */
-            val |= (rgb[1] << 8);
-            /* red */
-            val |= (rgb[0] << 16);
-
-            val |= 255 << 24;
 
-            cairo_buf[pos] = val;
+    if (!clip_blit(v, x_pos, y_pos, i->w, i->h, &br)) return;
+    if (alpha <= 0) return;
+
+    if (i->cov == NULL) image_mask(i);
+
+    clr = (r & 0xff) << 16 | (g & 0xff) << 8 | (b & 0xff);
+
+    for (y = br.y0; y < br.y1; y++) {
+        size_t row;
+        int k;
+
+        row = (size_t)v->width * (br.iy + y) + br.ix;
+
+        for (k = i->rowsegs[y]; k < i->rowsegs[y + 1]; k++) {
+            const int *seg;
+            const uint8_t *cov;
+            int x0, x1;
+
+            seg = &i->segs[3 * k];
+            x0 = seg[0] < br.x0 ? br.x0 : seg[0];
+            x1 = seg[1] > br.x1 ? br.x1 : seg[1];
+            if (x0 >= x1) continue;
+
+            cov = &i->cov[y * i->w + x0];
+
+            if (v->linear) {
+                if (seg[2]) {
+                    sg_lin_span(&v->linbuf[(row + x0) * 4],
+                                x1 - x0, clr, NULL, alpha);
+                } else {
+                    sg_lin_span8(&v->linbuf[(row + x0) * 4],
+                                 x1 - x0, clr, cov, 1, alpha);
+                }
+            } else {
+                if (seg[2]) {
+                    sg_colorlerp_span(&v->cairo_buf[row + x0],
+                                      x1 - x0, clr, NULL, alpha);
+                } else {
+                    sg_colorlerp_span8(&v->cairo_buf[row + x0],
+                                       x1 - x0, clr, cov, 1, alpha);
+                }
+            }
         }
     }
 }
@@ -823,6 +2033,10 @@ void sg_video_write_png(sg_video *v, const char *filename)
 
     if (v->cairo_buf == NULL) return;
 
+    if (v->linear) {
+        sg_pool_run(sg_pool_global(), v->height, lin_encode_row, v);
+    }
+
     buf = calloc(1, v->width * v->height * 4);
 
     cairo_buf = v->cairo_buf;
@@ -862,8 +2076,8 @@ void sg_video_set(sg_video *v, int x, int y, int r, int g, int b)
     uint32_t val;
     int pos;
 
-    if (x > v->width || x < 0) return;
-    if (y > v->height || y < 0) return;
+    if (x >= v->width || x < 0) return;
+    if (y >= v->height || y < 0) return;
 
     pos = v->width * y + x;
 
@@ -879,6 +2093,8 @@ void sg_video_set(sg_video *v, int x, int y, int r, int g, int b)
     val |= 255 << 24;
 
     v->cairo_buf[pos] = val;
+
+    if (v->linear) sg_lin_decode(&val, &v->linbuf[(size_t)pos * 4], 1);
 }
 
 int sg_video_get(sg_video *v, int x, int y, int *r, int *g, int *b)
@@ -887,11 +2103,13 @@ int sg_video_get(sg_video *v, int x, int y, int *r, int *g, int *b)
     uint32_t val;
     int pos;
 
-    if (x > v->width || x < 0) return 0;
-    if (y > v->height || y < 0) return 0;
+    if (x >= v->width || x < 0) return 0;
+    if (y >= v->height || y < 0) return 0;
 
     pos = v->width * y + x;
-    val = v->cairo_buf[pos];
+
+    if (v->linear) sg_lin_encode(&v->linbuf[(size_t)pos * 4], &val, 1);
+    else val = v->cairo_buf[pos];
 
 
     if (b != NULL) *b = val & 0xFF;
@@ -906,6 +2124,7 @@ int sg_video_text_add_font(sg_video *v,
                            const char *path)
 {
     if (v->fs == NULL) return FONS_INVALID;
+    if (v->textcache != NULL) sg_textcache_clear(v->textcache);
     return fonsAddFont(v->fs, name, path);
 }
 
@@ -920,18 +2139,21 @@ unsigned int sg_video_text_rgba(unsigned char r,
 void sg_video_text_clearstate(sg_video *v) {
     if (v->fs == NULL) return;
     fonsClearState(v->fs);
+    text_state_clear(v);
 }
 
 void sg_video_text_setsize(sg_video *v, float size)
 {
     if (v->fs == NULL) return;
     fonsSetSize(v->fs, size);
+    v->text_size = size;
 }
 
 void sg_video_text_setalign(sg_video *v, int align)
 {
     if (v->fs == NULL) return;
     fonsSetAlign(v->fs, align);
+    v->text_align = align;
 }
 
 void sg_video_text_vertmetrics(sg_video *v,
@@ -947,6 +2169,101 @@ void sg_video_text_setblur(sg_video *v, float blur)
 {
     if (v->fs == NULL) return;
     fonsSetBlur(v->fs, blur);
+    v->text_blur = blur;
+}
+
+/*
+ * Draws text through the run cache: a string drawn again with
+ * the same state, at the same subpixel step, is one blit of
+ * its cached coverage. Runs are rasterized at the snapped
+ * position, so a first draw and a cached one land alike.
+ */
+
+static float text_draw_cached(sg_video *v,
+                              float x, float y,
+                              const char *str,
+                              const char *end)
+{
+    sg_textkey key;
+    sg_textrun *run;
+    int ix, iy;
+    int len;
+    int x0, y0, x1, y1;
+    int cx0, cy0;
+    float sx, sy;
+    unsigned int c;
+    uint32_t clr;
+    size_t pos;
+
+    len = end != NULL ? end - str : strlen(str);
+
+    key.font = v->text_font;
+    key.size = v->text_size;
+    key.blur = v->text_blur;
+    key.align = v->text_align;
+    sg_textcache_snap(&key, x, y, &ix, &iy);
+    sx = ix + key.fx;
+    sy = iy + key.fy;
+
+    run = sg_textcache_find(v->textcache, &key, str, len);
+
+    if (run == NULL) {
+        float b[4];
+
+        /*
+         * centered text is aligned after the quads are snapped
+         * to pixels here, and before when drawn, so leave a
+         * pixel either way
+         */
+        fonsTextBounds(v->fs, sx, sy, str, end, b);
+        x0 = floor(b[0]) - 1;
+        y0 = floor(b[1]) - 1;
+        x1 = ceil(b[2]) + 1;
+        y1 = ceil(b[3]) + 1;
+
+        run = sg_textcache_add(v->textcache, &key, str, len,
+                               x1 - x0, y1 - y0);
+
+        /* empty, or too big to keep */
+        if (run == NULL) return fonsDrawText(v->fs, x, y, str, end);
+
+        run->ox = x0 - ix;
+        run->oy = y0 - iy;
+
+        sgfons_capture(v->fs, run->cov, x0, y0, run->w, run->h);
+        run->adv = fonsDrawText(v->fs, sx, sy, str, end) - sx;
+        sgfons_capture(v->fs, NULL, 0, 0, 0, 0);
+    }
+
+    /* clip the run to the frame */
+    x0 = ix + run->ox;
+    y0 = iy + run->oy;
+    cx0 = x0 < 0 ? -x0 : 0;
+    cy0 = y0 < 0 ? -y0 : 0;
+    x1 = run->w;
+    y1 = run->h;
+    if (x0 + x1 > v->width) x1 = v->width - x0;
+    if (y0 + y1 > v->height) y1 = v->height - y0;
+
+    if (cx0 < x1 && cy0 < y1) {
+        c = v->text_color;
+        clr = (c & 0xff) << 16 | (c & 0xff00) | ((c >> 16) & 0xff);
+        pos = (size_t)(y0 + cy0) * v->width + x0 + cx0;
+
+        if (v->linear) {
+            sg_lin_glyph(&v->linbuf[pos * 4], v->width,
+                         &run->cov[cy0 * run->w + cx0], run->w,
+                         x1 - cx0, y1 - cy0,
+                         clr, (c >> 24) / 255.f);
+        } else {
+            sg_colorlerp_glyph(&v->cairo_buf[pos], v->width,
+                               &run->cov[cy0 * run->w + cx0], run->w,
+                               x1 - cx0, y1 - cy0,
+                               clr, (c >> 24) / 255.f);
+        }
+    }
+
+    return x + run->adv;
 }
 
 float sg_video_text_draw(sg_video *v,
@@ -956,9 +2273,34 @@ float sg_video_text_draw(sg_video *v,
 {
 
     if (v->fs == NULL) return -1;
+    if (v->textcache != NULL) return text_draw_cached(v, x, y, str, end);
     return fonsDrawText(v->fs, x, y, str, end);
 }
 
+/*
+ * Turns on the text run cache, holding up to about bytes of
+ * runs. 0 turns it off.
+ */
+
+void sg_video_text_cache(sg_video *v, size_t bytes)
+{
+    sg_textcache_del(&v->textcache);
+    if (bytes > 0) sg_textcache_new(&v->textcache, bytes);
+}
+
+/* lookups that hit and missed, and bytes held; all 0 when off */
+
+void sg_video_text_cache_stats(sg_video *v,
+                               long *hits, long *misses,
+                               size_t *size)
+{
+    *hits = 0;
+    *misses = 0;
+    *size = 0;
+    if (v->textcache == NULL) return;
+    sg_textcache_stats(v->textcache, hits, misses, size);
+}
+
 int sg_video_invalidfont(sg_video *v, int font)
 {
     return font == FONS_INVALID;
@@ -968,12 +2310,14 @@ void sg_video_text_setfont(sg_video *v, int font)
 {
     if (v->fs == NULL) return;
     fonsSetFont(v->fs, font);
+    v->text_font = font;
 }
 
 void sg_video_text_setcolor(sg_video *v, unsigned int color)
 {
     if (v->fs == NULL) return;
     fonsSetColor(v->fs, color);
+    v->text_color = color;
 }
 
 void sg_video_move_to(sg_video *v, float x, float y)
@@ -1101,11 +2445,36 @@ int sg_video_framepos(sg_video *v)
     return v->i_frame;
 }
 
+/* xRGB pixels, one row is the frame width */
+
+uint32_t * sg_video_cairobuf(sg_video *v)
+{
+    return v->cairo_buf;
+}
+
+/* NULL unless linear light mode is on */
+
+uint16_t * sg_video_linbuf(sg_video *v)
+{
+    if (!v->linear) return NULL;
+    return v->linbuf;
+}
+
+/* NULL when the unshade buffer is planar */
+
 us_vec3 * sg_video_unshadebuf(sg_video *v)
 {
     return v->usbuf;
 }
 
+/* NULL unless the unshade buffer is planar */
+
+us_planes * sg_video_unshadeplanes(sg_video *v)
+{
+    if (v->usmem == NULL) return NULL;
+    return &v->usplanes;
+}
+
 
 void sg_video_dims(sg_video *v, int *w, int *h)
 {
@@ -1113,18 +2482,125 @@ void sg_video_dims(sg_video *v, int *w, int *h)
     if (h != NULL) *h = v->height;
 }
 
-void sg_video_unshade_init(sg_video *v)
+/*
+ * Sets the unshade buffer layout, either packed us_vec3
+ * pixels or three float planes. Must be called before
+ * sg_video_unshade_init.
+ */
+
+void sg_video_unshade_layout(sg_video *v, int layout)
 {
-    if (v->usbuf != NULL) return;
+    v->uslayout = layout;
+}
 
-    v->usbuf = malloc(sizeof(us_vec3) * v->width * v->height);
+void sg_video_unshade_init(sg_video *v)
+{
+    if (v->usbuf != NULL || v->usmem != NULL) return;
+
+    if (v->uslayout == SG_UNSHADE_PLANAR) {
+        int stride;
+        size_t plane;
+        float *p;
+
+        /* rows and planes start on 64-byte boundaries */
+        stride = (v->width + 15) & ~15;
+        plane = (size_t)stride * v->height;
+        v->usmem = malloc(sizeof(float) * (plane * 3 + 16));
+
+        p = v->usmem;
+        p += (16 - ((uintptr_t)p / sizeof(float)) % 16) % 16;
+
+        v->usplanes.r = p;
+        v->usplanes.g = p + plane;
+        v->usplanes.b = p + plane * 2;
+        v->usplanes.stride = stride;
+    } else {
+        v->usbuf = malloc(sizeof(us_vec3) * v->width * v->height);
+    }
 
     sg_video_unshade_clear(v, us_mkvec3(0.f, 0.f, 0.f));
 }
 
+/*
+ * Tile size the unshade shaders of this video are run in.
+ * Smaller tiles balance uneven shaders better, larger ones
+ * cost less to schedule.
+ */
+
+void sg_video_unshade_tile(sg_video *v, int w, int h)
+{
+    if (w < 1) w = 1;
+    if (h < 1) h = 1;
+    v->ustile_w = w;
+    v->ustile_h = h;
+}
+
+/* runs a shader over the unshade buffer, whatever its layout */
+
+void sg_video_unshade_draw(sg_video *v,
+                           void (*draw)(us_vec3 *, us_vec2, us_image_data *),
+                           void *ud)
+{
+    us_vec2 res;
+    res = us_mkvec2(v->width, v->height);
+
+    if (v->usmem != NULL) {
+        us_draw_tiled(NULL, &v->usplanes, res,
+                      v->i_frame, v->param.i_fps_num,
+                      draw, NULL, ud,
+                      v->ustile_w, v->ustile_h);
+    } else if (v->usbuf != NULL) {
+        us_draw_tiled(v->usbuf, NULL, res,
+                      v->i_frame, v->param.i_fps_num,
+                      draw, NULL, ud,
+                      v->ustile_w, v->ustile_h);
+    }
+}
+
+void sg_video_unshade_span(sg_video *v,
+                           void (*span)(float *, float *, float *,
+                                        int, us_vec2, us_image_data *),
+                           void *ud)
+{
+    us_vec2 res;
+    res = us_mkvec2(v->width, v->height);
+
+    if (v->usmem != NULL) {
+        us_draw_tiled(NULL, &v->usplanes, res,
+                      v->i_frame, v->param.i_fps_num,
+                      NULL, span, ud,
+                      v->ustile_w, v->ustile_h);
+    } else if (v->usbuf != NULL) {
+        us_draw_tiled(v->usbuf, NULL, res,
+                      v->i_frame, v->param.i_fps_num,
+                      NULL, span, ud,
+                      v->ustile_w, v->ustile_h);
+    }
+}
+
 void sg_video_unshade_clear(sg_video *v, us_vec3 color)
 {
     int x, y;
+
+    if (v->usmem != NULL) {
+        for (y = 0; y < v->height; y++) {
+            float *r, *g, *b;
+            int pos;
+
+            pos = y * v->usplanes.stride;
+            r = v->usplanes.r + pos;
+            g = v->usplanes.g + pos;
+            b = v->usplanes.b + pos;
+
+            for (x = 0; x < v->width; x++) {
+                r[x] = color.x;
+                g[x] = color.y;
+                b[x] = color.z;
+            }
+        }
+        return;
+    }
+
     if (v->usbuf == NULL) return;
 
     for (y = 0; y < v->height; y++) {
@@ -1136,37 +2612,219 @@ void sg_video_unshade_clear(sg_video *v, us_vec3 color)
     }
 }
 
-void sg_video_unshade_transfer(sg_video *v)
+/*
+ * Float to 8-bit for the transfer. Clamping first means
+ * truncation matches floor and values outside [0, 1] can no
+ * longer spill into the other channels. d is the dither
+ * offset, in [0, 1).
+ */
+
+static uint32_t unshade_byte(float c, float d)
 {
-    int x, y;
-    uint32_t *cairo_buf;
-    us_vec3 *usbuf;
+    c = c * 255 + d;
+    if (c < 0) c = 0;
+    if (c > 255) c = 255;
+    return (uint32_t)c;
+}
+
+/* 4x4 Bayer matrix, as offsets in [0, 1) */
+static const float bayer[4][4] = {
+    { 0.5f/16,  8.5f/16,  2.5f/16, 10.5f/16},
+    {12.5f/16,  4.5f/16, 14.5f/16,  6.5f/16},
+    { 3.5f/16, 11.5f/16,  1.5f/16,  9.5f/16},
+    {15.5f/16,  7.5f/16, 13.5f/16,  5.5f/16}
+};
 
-    if (v->usbuf == NULL || v->cairo_buf == NULL) return;
+static const float nodither[4] = {0, 0, 0, 0};
 
-    usbuf = v->usbuf;
-    cairo_buf = v->cairo_buf;
+/* converts row y of the unshade buffer to RGB24 pixels */
+
+static void unshade_row(sg_video *v, int y, uint32_t *row)
+{
+    const float *d;
+    int x;
+
+    d = v->usdither ? bayer[y & 3] : nodither;
+
+    if (v->usmem != NULL) {
+        float *r, *g, *b;
+        int pos;
+
+        pos = y * v->usplanes.stride;
+        r = v->usplanes.r + pos;
+        g = v->usplanes.g + pos;
+        b = v->usplanes.b + pos;
 
-    for (y = 0; y < v->height; y++) {
         for (x = 0; x < v->width; x++) {
-            int pos;
-            uint32_t *val;
-            us_vec3 *c;
+            row[x] = 255U << 24 |
+                unshade_byte(r[x], d[x & 3]) << 16 |
+                unshade_byte(g[x], d[x & 3]) << 8 |
+                unshade_byte(b[x], d[x & 3]);
+        }
+    } else {
+        us_vec3 *c;
 
-            pos = v->width * y + x;
-            val = &cairo_buf[pos];
-            c = &usbuf[pos];
-
-            /* clear pixel */
-            *val = 0;
-            /* blue (z) */
-            *val |= (int)floor(c->z * 255);
-            /* green (y) */
-            *val |= ((int)floor(c->y * 255)) << 8;
-            /* red (x) */
-            *val |= ((int)floor(c->x * 255)) << 16;
-            /* alpha (100%) */
-            *val |= 255 << 24;
+        c = &v->usbuf[y * v->width];
+
+        for (x = 0; x < v->width; x++) {
+            row[x] = 255U << 24 |
+                unshade_byte(c[x].x, d[x & 3]) << 16 |
+                unshade_byte(c[x].y, d[x & 3]) << 8 |
+                unshade_byte(c[x].z, d[x & 3]);
+        }
+    }
+}
+
+/*
+ * Ordered dithering for the unshade buffer, used by both
+ * sg_video_unshade_transfer and sg_video_unshade_append.
+ * It hides banding in smooth gradients.
+ */
+
+void sg_video_unshade_dither(sg_video *v, int dither)
+{
+    v->usdither = dither;
+}
+
+static void transfer_row(void *ud, int y, int thread)
+{
+    sg_video *v;
+    v = ud;
+    unshade_row(v, y, &v->cairo_buf[y * v->width]);
+
+    if (v->linear) lin_decode_row(v, y, thread);
+}
+
+void sg_video_unshade_transfer(sg_video *v)
+{
+    if (v->cairo_buf == NULL) return;
+    if (v->usbuf == NULL && v->usmem == NULL) return;
+
+    sg_pool_run(sg_pool_global(), v->height, transfer_row, v);
+}
+
+/*
+ * The fused path converts the unshade buffer a band of rows
+ * at a time into a small per-thread RGB24 scratch, which stays
+ * in cache while it is turned into YUV.
+ */
+
+#define UNSHADE_BAND 8
+
+struct unshade_job {
+    sg_video *v;
+    uint32_t *scratch;
+};
+
+static void unshade_band(void *ud, int band, int thread)
+{
+    struct unshade_job *job;
+    sg_video *v;
+    uint32_t *buf;
+    int y0, nrows;
+    int y;
+    uint8_t **pl;
+    int *st;
+
+    job = ud;
+    v = job->v;
+    buf = job->scratch + (size_t)thread * UNSHADE_BAND * v->width;
+
+    y0 = band * UNSHADE_BAND;
+    nrows = v->height - y0;
+    if (nrows > UNSHADE_BAND) nrows = UNSHADE_BAND;
+
+    for (y = 0; y < nrows; y++) {
+        unshade_row(v, y0 + y, buf + y * v->width);
+    }
+
+    pl = v->pic.img.plane;
+    st = v->pic.img.i_stride;
+
+    switch (v->csp) {
+        case SG_VIDEO_I420:
+            sg_yuv420(buf, v->width * 4, v->width, nrows,
+                      pl[0] + y0 * st[0], st[0],
+                      pl[1] + y0 / 2 * st[1], st[1],
+                      pl[2] + y0 / 2 * st[2], st[2]);
+            break;
+        case SG_VIDEO_NV12:
+            sg_yuv_nv12(buf, v->width * 4, v->width, nrows,
+                        pl[0] + y0 * st[0], st[0],
+                        pl[1] + y0 / 2 * st[1], st[1]);
+            break;
+        default:
+            sg_yuv444(buf, v->width * 4, v->width, nrows,
+                      pl[0] + y0 * st[0], st[0],
+                      pl[1] + y0 * st[1], st[1],
+                      pl[2] + y0 * st[2], st[2]);
+            break;
+    }
+}
+
+/* one row of the unshade buffer into a ring slot */
+
+struct unshade_ring_job {
+    sg_video *v;
+    uint32_t *dst;
+};
+
+static void unshade_ring_row(void *ud, int y, int thread)
+{
+    struct unshade_ring_job *job;
+    job = ud;
+    unshade_row(job->v, y, job->dst + y * (job->v->stride / 4));
+}
+
+/*
+ * Appends the unshade buffer as the next frame, without going
+ * through the cairo buffer. Use it in place of
+ * sg_video_unshade_transfer and sg_video_append when nothing
+ * is drawn on top with cairo. The frame is the unshade buffer
+ * alone, so anything composited in linear mode is not in it.
+ */
+
+void sg_video_unshade_append(sg_video *v)
+{
+    sg_pool *pool;
+
+    if (v->h == NULL) return;
+    if (v->usbuf == NULL && v->usmem == NULL) return;
+
+    pool = sg_pool_global();
+
+    if (v->nring > 0) {
+        /* the ring holds RGB24, so write the frame straight into it */
+        struct unshade_ring_job job;
+        int slot;
+
+        slot = ring_acquire(v);
+        job.v = v;
+        job.dst = v->ring[slot];
+        sg_pool_run(pool, v->height, unshade_ring_row, &job);
+        ring_publish(v, slot);
+    } else {
+        struct unshade_job job;
+        int nbands;
+        size_t sz;
+
+        nbands = (v->height + UNSHADE_BAND - 1) / UNSHADE_BAND;
+
+        /* grows with the pool, which can be resized between frames */
+        sz = (size_t)v->width * UNSHADE_BAND * sg_pool_nthreads(pool);
+        if (sz > v->usscratch_size) {
+            free(v->usscratch);
+            v->usscratch = malloc(sizeof(uint32_t) * sz);
+            v->usscratch_size = sz;
         }
+
+        job.v = v;
+        job.scratch = v->usscratch;
+
+        sg_pool_run(pool, nbands, unshade_band, &job);
+
+        encode_frame(v, v->i_frame);
     }
+
+    v->i_frame++;
 }
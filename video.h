@@ -2,7 +2,10 @@
 #define SG_VIDEO_H
 typedef struct sg_video sg_video;
 typedef struct sg_image sg_image;
+typedef struct sg_atlas sg_atlas;
+typedef struct sg_fbm_field sg_fbm_field;
 
+#include <stdint.h>
 #include "unshade.h"
 
 #ifdef SG_VIDEO_PRIVATE
@@ -27,20 +30,127 @@ struct sg_video {
     uint8_t *ubuf;
     uint8_t *vbuf;
     unsigned int sz;
+    int csp;
+    int enc_threads;
+    int enc_sliced;
+    int lossless;
+    struct sg_mp4 *mp4;
+
+    /* encoder pipeline */
+    int pipeline;
+    int nring;
+    uint32_t **ring;
+    int64_t *ring_pts;
+    int ring_head;
+    int ring_tail;
+    int ring_count;
+    int ring_done;
+    pthread_t enc_thread;
+    pthread_mutex_t ring_lock;
+    pthread_cond_t ring_filled;
+    pthread_cond_t ring_freed;
+
+    /* linear light frame, and a row of it for decoding images */
+    uint16_t *linbuf;
+    int linear;
+    uint16_t *linrow;
+    size_t linrow_size;
 
     /* fontstash */
     FONScontext *fs;
 
+    /* glyph atlas: starting size, largest side it grows to */
+    int atlas_w, atlas_h;
+    int atlas_max;
+    int atlas_grows;
+    int atlas_resets;
+
+    /* fontstash state, mirrored for the text run cache */
+    int text_font;
+    float text_size;
+    float text_blur;
+    int text_align;
+    unsigned int text_color;
+    struct sg_textcache *textcache;
+
     /* unshade buffer */
     us_vec3 *usbuf;
+    int uslayout;
+    int usdither;
+    us_planes usplanes;
+    float *usmem;
+    int ustile_w, ustile_h;
+
+    /* per-thread RGB24 bands for sg_video_unshade_append */
+    uint32_t *usscratch;
+    size_t usscratch_size;
+
+    /* fbm: output pixels per sample, and the sampled field */
+    int fbmdiv;
+    float *fbmbuf;
+    size_t fbmbuf_size;
+    sg_fbm_field *fbmfield;
 };
 
 struct sg_image {
     unsigned char *img;
+    uint32_t *argb;
     unsigned int w;
     unsigned int h;
+
+    /* premultiplied copy, and the visible runs of each row */
+    uint32_t *pm;
+    int *runs;
+    int *rowruns;
+
+    /* mipmap levels below pm, halved each time, built on demand */
+    uint32_t **mips;
+    int nmips;
+
+    /*
+     * stencil mask from the red channel, built on demand: runs
+     * of x0, x1, solid for the parts of each row with coverage
+     */
+    uint8_t *cov;
+    int *segs;
+    int *rowsegs;
+};
+
+struct sg_fbm_field {
+    /* what qy was computed for */
+    int w, h;
+    int div;
+    int noct;
+
+    /* qy over the sample grid */
+    float *qy;
+};
+
+struct sg_atlas {
+    sg_image *img;
+    struct sg_skyline *sky;
+
+    /* x, y, w, h of each image */
+    int *rects;
+    int nrects;
+    int crects;
+    int dirty;
 };
 #endif
+
+/* unshade buffer layouts */
+enum {
+    SG_UNSHADE_PACKED,
+    SG_UNSHADE_PLANAR
+};
+
+/* output colorspaces */
+enum {
+    SG_VIDEO_I444,
+    SG_VIDEO_I420,
+    SG_VIDEO_NV12
+};
+
 void sg_video_new(sg_video **pv);
 void sg_video_del(sg_video **pv);
 void sg_video_open(sg_video *v,
@@ -49,6 +159,11 @@ void sg_video_open(sg_video *v,
                    int fps);
 void sg_video_append(sg_video *v);
 void sg_video_close(sg_video *v);
+void sg_video_colorspace(sg_video *v, int csp);
+void sg_video_encoder_threads(sg_video *v, int nthreads, int sliced);
+void sg_video_lossless(sg_video *v, int on);
+void sg_video_pipeline(sg_video *v, int nframes);
+void sg_video_threads(sg_video *v, int nthreads);
 
 /* drawing routines */
 void sg_video_color(sg_video *v,
@@ -119,7 +234,32 @@ void sg_video_image_withalpha(sg_video *v,
                               float alpha);
 
 
+void sg_video_image_over(sg_video *v,
+                         sg_image *i,
+                         float x_pos,
+                         float y_pos,
+                         float alpha);
+
+void sg_video_image_draw(sg_video *v,
+                         sg_image *i,
+                         float x, float y,
+                         float sx, float sy,
+                         float angle,
+                         float alpha);
+
 void sg_image_dims(sg_image *i, int *w, int *h);
+
+void sg_atlas_new(sg_atlas **pa, int w, int h);
+void sg_atlas_del(sg_atlas **pa);
+int sg_atlas_add(sg_atlas *a, const char *filename);
+int sg_atlas_dims(sg_atlas *a, int id, int *w, int *h);
+void sg_video_atlas(sg_video *v,
+                    sg_atlas *a,
+                    int id,
+                    float x_pos,
+                    float y_pos,
+                    float alpha);
+
 void sg_video_scale(sg_video *v, float sx, float xy);
 void sg_video_rect(sg_video *v, float x, float y, float w, float h);
 void sg_video_evenodd(sg_video *v);
@@ -143,6 +283,13 @@ void sg_video_roundtri(sg_video *v,
                        float s,
                        float round);
 void sg_video_fbm(sg_video *v, int r, int g, int b, int noct, float t);
+void sg_video_fbm_quality(sg_video *v, int div);
+void sg_fbm_field_new(sg_fbm_field **pf);
+void sg_fbm_field_del(sg_fbm_field **pf);
+void sg_video_fbm_field(sg_video *v,
+                        int r, int g, int b,
+                        int noct, float t,
+                        sg_fbm_field *f);
 
 
 /* fontstash wrappers */
@@ -171,18 +318,57 @@ float sg_video_text_draw(sg_video *v,
                          float x, float y,
                          const char *str,
                          const char *end);
+void sg_video_text_cache(sg_video *v, size_t bytes);
+void sg_video_text_cache_stats(sg_video *v,
+                               long *hits, long *misses,
+                               size_t *size);
+
+typedef struct {
+    int w, h;
+    int hits, misses;
+    int rasters;
+    int grows, resets;
+} sg_text_atlas_stats;
+
+/* largest side the glyph atlas grows to by default */
+#define SG_TEXT_ATLAS_MAX 2048
+
+void sg_video_text_atlas(sg_video *v, int w, int h, int max);
+void sg_video_text_atlas_stats(sg_video *v, sg_text_atlas_stats *s);
 
 void sg_video_dims(sg_video *v, int *w, int *h);
 
 int sg_video_fps(sg_video *v);
 int sg_video_framepos(sg_video *v);
 
+uint32_t * sg_video_cairobuf(sg_video *v);
+uint16_t * sg_video_linbuf(sg_video *v);
+
+void sg_video_linear(sg_video *v, int on);
 us_vec3 * sg_video_unshadebuf(sg_video *v);
+us_planes * sg_video_unshadeplanes(sg_video *v);
+
+void sg_video_unshade_layout(sg_video *v, int layout);
 
 void sg_video_unshade_init(sg_video *v);
 
+void sg_video_unshade_tile(sg_video *v, int w, int h);
+
+void sg_video_unshade_draw(sg_video *v,
+                           void (*draw)(us_vec3 *, us_vec2, us_image_data *),
+                           void *ud);
+
+void sg_video_unshade_span(sg_video *v,
+                           void (*span)(float *, float *, float *,
+                                        int, us_vec2, us_image_data *),
+                           void *ud);
+
 void sg_video_unshade_clear(sg_video *v, us_vec3 color);
 
 void sg_video_unshade_transfer(sg_video *v);
 
+void sg_video_unshade_dither(sg_video *v, int dither);
+
+void sg_video_unshade_append(sg_video *v);
+
 #endif
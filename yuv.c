@@ -0,0 +1,690 @@
+/*
+ * Copyright (c) 2021 Muvik Labs, LLC
+ * Distributed under the MIT license.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "yuv.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SG_YUV_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * RGB to YUV conversion, using the coefficients from
+ * https://www.fourcc.org/fccyvrgb.php
+ *
+ * Y = 0.299R + 0.587G + 0.114B
+ * U = 0.5 + 0.564 * (B - Y)
+ * V = 0.5 + 0.713 * (R - Y)
+ *
+ * Scaled up so that everything is an exact integer, the
+ * truncated 8-bit results become:
+ *
+ * Y = (299R + 587G + 114B) / 1000
+ * U = (127500000 - 168636R - 331068G + 499704B) / 1000000
+ * V = (127500000 + 499813R - 418531G - 81282B) / 1000000
+ *
+ * All numerators are non-negative and fit in 32 bits.
+ *
+ * Subsampled chroma is computed from the sums of each 2x2
+ * block: the numerators above with the bias and divisor
+ * multiplied by 4. This still fits in 32 bits.
+ */
+
+#define YR 299
+#define YG 587
+#define YB 114
+#define YD 1000
+
+#define UVBIAS 127500000
+#define UR 168636
+#define UG 331068
+#define UB 499704
+#define VR 499813
+#define VG 418531
+#define VB 81282
+#define UVD 1000000
+
+/* k is the number of pixels summed into r, g, and b */
+
+static void chroma_c(int32_t r, int32_t g, int32_t b, int32_t k,
+                     uint8_t *u, uint8_t *v)
+{
+    *u = (k*UVBIAS - UR*r - UG*g + UB*b) / (k*UVD);
+    *v = (k*UVBIAS + VR*r - VG*g - VB*b) / (k*UVD);
+}
+
+static void split_c(uint32_t tmp, int32_t *r, int32_t *g, int32_t *b)
+{
+    *b = tmp & 0xff;
+    *g = (tmp >> 8) & 0xff;
+    *r = (tmp >> 16) & 0xff;
+}
+
+static void row444_c(const uint32_t *pix,
+                     uint8_t *y, uint8_t *u, uint8_t *v,
+                     int n)
+{
+    int x;
+
+    for (x = 0; x < n; x++) {
+        int32_t r, g, b;
+
+        split_c(pix[x], &r, &g, &b);
+
+        y[x] = (YR*r + YG*g + YB*b) / YD;
+        chroma_c(r, g, b, 1, &u[x], &v[x]);
+    }
+}
+
+static void rowy_c(const uint32_t *pix, uint8_t *y, int n)
+{
+    int x;
+
+    for (x = 0; x < n; x++) {
+        int32_t r, g, b;
+
+        split_c(pix[x], &r, &g, &b);
+        y[x] = (YR*r + YG*g + YB*b) / YD;
+    }
+}
+
+/* n chroma samples from 2n pixels in rows p0 and p1 */
+
+static void row420_c(const uint32_t *p0, const uint32_t *p1,
+                     uint8_t *u, uint8_t *v,
+                     int n)
+{
+    int x;
+
+    for (x = 0; x < n; x++) {
+        int32_t r[4], g[4], b[4];
+
+        split_c(p0[2*x], &r[0], &g[0], &b[0]);
+        split_c(p0[2*x + 1], &r[1], &g[1], &b[1]);
+        split_c(p1[2*x], &r[2], &g[2], &b[2]);
+        split_c(p1[2*x + 1], &r[3], &g[3], &b[3]);
+
+        chroma_c(r[0] + r[1] + r[2] + r[3],
+                 g[0] + g[1] + g[2] + g[3],
+                 b[0] + b[1] + b[2] + b[3],
+                 4,
+                 &u[x], &v[x]);
+    }
+}
+
+#ifdef SG_YUV_X86
+
+/*
+ * The SIMD kernels divide by converting to float, multiplying
+ * by the reciprocal, and truncating. The estimate is at most
+ * one off, and q*d is exact in float for q <= 255, so one
+ * integer compare in each direction fixes it up.
+ */
+
+__attribute__((target("sse2")))
+static __m128i div_sse2(__m128i n, float d)
+{
+    __m128i q, p;
+
+    q = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(n),
+                                    _mm_set1_ps(1.0f / d)));
+    p = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(q),
+                                    _mm_set1_ps(d)));
+
+    /* too big: p > n */
+    q = _mm_add_epi32(q, _mm_cmpgt_epi32(p, n));
+    /* too small: n - p >= d */
+    q = _mm_sub_epi32(q, _mm_cmpgt_epi32(_mm_sub_epi32(n, p),
+                                         _mm_set1_epi32((int)d - 1)));
+    return q;
+}
+
+/* x * c, for x < 2^15 and c < 2^25. SSE2 has no 32-bit mullo */
+
+__attribute__((target("sse2")))
+static __m128i mulc_sse2(__m128i x, int c)
+{
+    __m128i lo, hi;
+
+    lo = _mm_madd_epi16(x, _mm_set1_epi32(c & 0x3ff));
+    hi = _mm_madd_epi16(x, _mm_set1_epi32(c >> 10));
+
+    return _mm_add_epi32(lo, _mm_slli_epi32(hi, 10));
+}
+
+__attribute__((target("sse2")))
+static void split_sse2(const uint32_t *pix,
+                       __m128i *r, __m128i *g, __m128i *b)
+{
+    __m128i px, mask;
+
+    mask = _mm_set1_epi32(0xff);
+    px = _mm_loadu_si128((const __m128i *)pix);
+    *b = _mm_and_si128(px, mask);
+    *g = _mm_and_si128(_mm_srli_epi32(px, 8), mask);
+    *r = _mm_and_si128(_mm_srli_epi32(px, 16), mask);
+}
+
+__attribute__((target("sse2")))
+static __m128i luma_sse2(__m128i r, __m128i g, __m128i b)
+{
+    __m128i n;
+
+    n = _mm_add_epi32(mulc_sse2(r, YR), mulc_sse2(g, YG));
+    n = _mm_add_epi32(n, mulc_sse2(b, YB));
+    return div_sse2(n, YD);
+}
+
+__attribute__((target("sse2")))
+static void chroma_sse2(__m128i r, __m128i g, __m128i b, int k,
+                        __m128i *u, __m128i *v)
+{
+    __m128i n;
+
+    n = _mm_add_epi32(_mm_set1_epi32(k*UVBIAS), mulc_sse2(b, UB));
+    n = _mm_sub_epi32(n, mulc_sse2(r, UR));
+    n = _mm_sub_epi32(n, mulc_sse2(g, UG));
+    *u = div_sse2(n, k*UVD);
+
+    n = _mm_add_epi32(_mm_set1_epi32(k*UVBIAS), mulc_sse2(r, VR));
+    n = _mm_sub_epi32(n, mulc_sse2(g, VG));
+    n = _mm_sub_epi32(n, mulc_sse2(b, VB));
+    *v = div_sse2(n, k*UVD);
+}
+
+/* adds neighboring pairs: a0+a1, a2+a3, b0+b1, b2+b3 */
+
+__attribute__((target("sse2")))
+static __m128i pairs_sse2(__m128i a, __m128i b)
+{
+    __m128 fa, fb;
+
+    fa = _mm_castsi128_ps(a);
+    fb = _mm_castsi128_ps(b);
+
+    return _mm_add_epi32(
+        _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(2, 0, 2, 0))),
+        _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(3, 1, 3, 1))));
+}
+
+/* 2x2 sums for 4 chroma samples, from 8 pixels in each row */
+
+__attribute__((target("sse2")))
+static void sum4_sse2(const uint32_t *p0, const uint32_t *p1,
+                      __m128i *r, __m128i *g, __m128i *b)
+{
+    __m128i r0, g0, b0;
+    __m128i r1, g1, b1;
+    __m128i rt, gt, bt;
+
+    split_sse2(p0, &r0, &g0, &b0);
+    split_sse2(p1, &rt, &gt, &bt);
+    r0 = _mm_add_epi32(r0, rt);
+    g0 = _mm_add_epi32(g0, gt);
+    b0 = _mm_add_epi32(b0, bt);
+
+    split_sse2(p0 + 4, &r1, &g1, &b1);
+    split_sse2(p1 + 4, &rt, &gt, &bt);
+    r1 = _mm_add_epi32(r1, rt);
+    g1 = _mm_add_epi32(g1, gt);
+    b1 = _mm_add_epi32(b1, bt);
+
+    *r = pairs_sse2(r0, r1);
+    *g = pairs_sse2(g0, g1);
+    *b = pairs_sse2(b0, b1);
+}
+
+__attribute__((target("sse2")))
+static __m128i pack16_sse2(__m128i *c)
+{
+    return _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]),
+                            _mm_packs_epi32(c[2], c[3]));
+}
+
+/* 16 pixels per iteration */
+
+__attribute__((target("sse2")))
+static void row444_sse2(const uint32_t *pix,
+                        uint8_t *y, uint8_t *u, uint8_t *v,
+                        int n)
+{
+    int x;
+
+    for (x = 0; x + 16 <= n; x += 16) {
+        __m128i yy[4], uu[4], vv[4];
+        int i;
+
+        for (i = 0; i < 4; i++) {
+            __m128i r, g, b;
+            split_sse2(pix + x + 4*i, &r, &g, &b);
+            yy[i] = luma_sse2(r, g, b);
+            chroma_sse2(r, g, b, 1, &uu[i], &vv[i]);
+        }
+
+        _mm_storeu_si128((__m128i *)(y + x), pack16_sse2(yy));
+        _mm_storeu_si128((__m128i *)(u + x), pack16_sse2(uu));
+        _mm_storeu_si128((__m128i *)(v + x), pack16_sse2(vv));
+    }
+
+    row444_c(pix + x, y + x, u + x, v + x, n - x);
+}
+
+__attribute__((target("sse2")))
+static void rowy_sse2(const uint32_t *pix, uint8_t *y, int n)
+{
+    int x;
+
+    for (x = 0; x + 16 <= n; x += 16) {
+        __m128i yy[4];
+        int i;
+
+        for (i = 0; i < 4; i++) {
+            __m128i r, g, b;
+            split_sse2(pix + x + 4*i, &r, &g, &b);
+            yy[i] = luma_sse2(r, g, b);
+        }
+
+        _mm_storeu_si128((__m128i *)(y + x), pack16_sse2(yy));
+    }
+
+    rowy_c(pix + x, y + x, n - x);
+}
+
+/* 16 chroma samples (32 pixels per row) per iteration */
+
+__attribute__((target("sse2")))
+static void row420_sse2(const uint32_t *p0, const uint32_t *p1,
+                        uint8_t *u, uint8_t *v,
+                        int n)
+{
+    int x;
+
+    for (x = 0; x + 16 <= n; x += 16) {
+        __m128i uu[4], vv[4];
+        int i;
+
+        for (i = 0; i < 4; i++) {
+            __m128i r, g, b;
+            sum4_sse2(p0 + 2*x + 8*i, p1 + 2*x + 8*i, &r, &g, &b);
+            chroma_sse2(r, g, b, 4, &uu[i], &vv[i]);
+        }
+
+        _mm_storeu_si128((__m128i *)(u + x), pack16_sse2(uu));
+        _mm_storeu_si128((__m128i *)(v + x), pack16_sse2(vv));
+    }
+
+    row420_c(p0 + 2*x, p1 + 2*x, u + x, v + x, n - x);
+}
+
+__attribute__((target("avx2")))
+static __m256i div_avx2(__m256i n, float d)
+{
+    __m256i q, p;
+
+    q = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(n),
+                                          _mm256_set1_ps(1.0f / d)));
+    p = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(q),
+                                          _mm256_set1_ps(d)));
+
+    q = _mm256_add_epi32(q, _mm256_cmpgt_epi32(p, n));
+    q = _mm256_sub_epi32(q,
+                         _mm256_cmpgt_epi32(_mm256_sub_epi32(n, p),
+                                            _mm256_set1_epi32((int)d - 1)));
+    return q;
+}
+
+__attribute__((target("avx2")))
+static __m256i mulc_avx2(__m256i x, int c)
+{
+    return _mm256_mullo_epi32(x, _mm256_set1_epi32(c));
+}
+
+__attribute__((target("avx2")))
+static void split_avx2(const uint32_t *pix,
+                       __m256i *r, __m256i *g, __m256i *b)
+{
+    __m256i px, mask;
+
+    mask = _mm256_set1_epi32(0xff);
+    px = _mm256_loadu_si256((const __m256i *)pix);
+    *b = _mm256_and_si256(px, mask);
+    *g = _mm256_and_si256(_mm256_srli_epi32(px, 8), mask);
+    *r = _mm256_and_si256(_mm256_srli_epi32(px, 16), mask);
+}
+
+__attribute__((target("avx2")))
+static __m256i luma_avx2(__m256i r, __m256i g, __m256i b)
+{
+    __m256i n;
+
+    n = _mm256_add_epi32(mulc_avx2(r, YR), mulc_avx2(g, YG));
+    n = _mm256_add_epi32(n, mulc_avx2(b, YB));
+    return div_avx2(n, YD);
+}
+
+__attribute__((target("avx2")))
+static void chroma_avx2(__m256i r, __m256i g, __m256i b, int k,
+                        __m256i *u, __m256i *v)
+{
+    __m256i n;
+
+    n = _mm256_add_epi32(_mm256_set1_epi32(k*UVBIAS), mulc_avx2(b, UB));
+    n = _mm256_sub_epi32(n, mulc_avx2(r, UR));
+    n = _mm256_sub_epi32(n, mulc_avx2(g, UG));
+    *u = div_avx2(n, k*UVD);
+
+    n = _mm256_add_epi32(_mm256_set1_epi32(k*UVBIAS), mulc_avx2(r, VR));
+    n = _mm256_sub_epi32(n, mulc_avx2(g, VG));
+    n = _mm256_sub_epi32(n, mulc_avx2(b, VB));
+    *v = div_avx2(n, k*UVD);
+}
+
+/* hadd works per 128-bit lane, so put the sums back in order */
+
+__attribute__((target("avx2")))
+static __m256i pairs_avx2(__m256i a, __m256i b)
+{
+    return _mm256_permute4x64_epi64(_mm256_hadd_epi32(a, b),
+                                    _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+/* 2x2 sums for 8 chroma samples, from 16 pixels in each row */
+
+__attribute__((target("avx2")))
+static void sum4_avx2(const uint32_t *p0, const uint32_t *p1,
+                      __m256i *r, __m256i *g, __m256i *b)
+{
+    __m256i r0, g0, b0;
+    __m256i r1, g1, b1;
+    __m256i rt, gt, bt;
+
+    split_avx2(p0, &r0, &g0, &b0);
+    split_avx2(p1, &rt, &gt, &bt);
+    r0 = _mm256_add_epi32(r0, rt);
+    g0 = _mm256_add_epi32(g0, gt);
+    b0 = _mm256_add_epi32(b0, bt);
+
+    split_avx2(p0 + 8, &r1, &g1, &b1);
+    split_avx2(p1 + 8, &rt, &gt, &bt);
+    r1 = _mm256_add_epi32(r1, rt);
+    g1 = _mm256_add_epi32(g1, gt);
+    b1 = _mm256_add_epi32(b1, bt);
+
+    *r = pairs_avx2(r0, r1);
+    *g = pairs_avx2(g0, g1);
+    *b = pairs_avx2(b0, b1);
+}
+
+/* packs are per 128-bit lane, so put the dwords back in order */
+
+__attribute__((target("avx2")))
+static __m256i pack32_avx2(__m256i *c)
+{
+    __m256i p;
+
+    p = _mm256_packus_epi16(_mm256_packs_epi32(c[0], c[1]),
+                            _mm256_packs_epi32(c[2], c[3]));
+
+    return _mm256_permutevar8x32_epi32(p,
+                                       _mm256_setr_epi32(0, 4, 1, 5,
+                                                         2, 6, 3, 7));
+}
+
+/* 32 pixels per iteration */
+
+__attribute__((target("avx2")))
+static void row444_avx2(const uint32_t *pix,
+                        uint8_t *y, uint8_t *u, uint8_t *v,
+                        int n)
+{
+    int x;
+
+    for (x = 0; x + 32 <= n; x += 32) {
+        __m256i yy[4], uu[4], vv[4];
+        int i;
+
+        for (i = 0; i < 4; i++) {
+            __m256i r, g, b;
+            split_avx2(pix + x + 8*i, &r, &g, &b);
+            yy[i] = luma_avx2(r, g, b);
+            chroma_avx2(r, g, b, 1, &uu[i], &vv[i]);
+        }
+
+        _mm256_storeu_si256((__m256i *)(y + x), pack32_avx2(yy));
+        _mm256_storeu_si256((__m256i *)(u + x), pack32_avx2(uu));
+        _mm256_storeu_si256((__m256i *)(v + x), pack32_avx2(vv));
+    }
+
+    row444_sse2(pix + x, y + x, u + x, v + x, n - x);
+}
+
+__attribute__((target("avx2")))
+static void rowy_avx2(const uint32_t *pix, uint8_t *y, int n)
+{
+    int x;
+
+    for (x = 0; x + 32 <= n; x += 32) {
+        __m256i yy[4];
+        int i;
+
+        for (i = 0; i < 4; i++) {
+            __m256i r, g, b;
+            split_avx2(pix + x + 8*i, &r, &g, &b);
+            yy[i] = luma_avx2(r, g, b);
+        }
+
+        _mm256_storeu_si256((__m256i *)(y + x), pack32_avx2(yy));
+    }
+
+    rowy_sse2(pix + x, y + x, n - x);
+}
+
+/* 32 chroma samples (64 pixels per row) per iteration */
+
+__attribute__((target("avx2")))
+static void row420_avx2(const uint32_t *p0, const uint32_t *p1,
+                        uint8_t *u, uint8_t *v,
+                        int n)
+{
+    int x;
+
+    for (x = 0; x + 32 <= n; x += 32) {
+        __m256i uu[4], vv[4];
+        int i;
+
+        for (i = 0; i < 4; i++) {
+            __m256i r, g, b;
+            sum4_avx2(p0 + 2*x + 16*i, p1 + 2*x + 16*i, &r, &g, &b);
+            chroma_avx2(r, g, b, 4, &uu[i], &vv[i]);
+        }
+
+        _mm256_storeu_si256((__m256i *)(u + x), pack32_avx2(uu));
+        _mm256_storeu_si256((__m256i *)(v + x), pack32_avx2(vv));
+    }
+
+    row420_sse2(p0 + 2*x, p1 + 2*x, u + x, v + x, n - x);
+}
+#endif
+
+static void (*row444)(const uint32_t *,
+                      uint8_t *, uint8_t *, uint8_t *,
+                      int) = NULL;
+
+static void (*rowy)(const uint32_t *, uint8_t *, int) = NULL;
+
+static void (*row420)(const uint32_t *, const uint32_t *,
+                      uint8_t *, uint8_t *,
+                      int) = NULL;
+
+/* picks the fastest kernels the CPU supports */
+
+void sg_yuv_init(void)
+{
+    if (row444 != NULL) return;
+
+#ifdef SG_YUV_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        rowy = rowy_avx2;
+        row420 = row420_avx2;
+        row444 = row444_avx2;
+        return;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        rowy = rowy_sse2;
+        row420 = row420_sse2;
+        row444 = row444_sse2;
+        return;
+    }
+#endif
+
+    rowy = rowy_c;
+    row420 = row420_c;
+    row444 = row444_c;
+}
+
+/* stride is in bytes, like cairo */
+
+void sg_yuv444(const uint32_t *pix, int stride,
+               int w, int h,
+               uint8_t *y, int ystride,
+               uint8_t *u, int ustride,
+               uint8_t *v, int vstride)
+{
+    int row;
+    const uint8_t *p;
+
+    sg_yuv_init();
+
+    p = (const uint8_t *)pix;
+
+    for (row = 0; row < h; row++) {
+        row444((const uint32_t *)(p + row*stride),
+               y + row*ystride,
+               u + row*ustride,
+               v + row*vstride,
+               w);
+    }
+}
+
+/*
+ * One row pair of 4:2:0 output. Odd sizes repeat the last
+ * column (and the caller repeats the last row).
+ */
+
+static void rowpair420(const uint32_t *p0, const uint32_t *p1,
+                       int w,
+                       uint8_t *y0, uint8_t *y1,
+                       uint8_t *u, uint8_t *v)
+{
+    rowy(p0, y0, w);
+    if (y1 != NULL) rowy(p1, y1, w);
+
+    row420(p0, p1, u, v, w / 2);
+
+    if (w & 1) {
+        uint32_t e0[2], e1[2];
+
+        e0[0] = e0[1] = p0[w - 1];
+        e1[0] = e1[1] = p1[w - 1];
+        row420_c(e0, e1, u + w/2, v + w/2, 1);
+    }
+}
+
+void sg_yuv420(const uint32_t *pix, int stride,
+               int w, int h,
+               uint8_t *y, int ystride,
+               uint8_t *u, int ustride,
+               uint8_t *v, int vstride)
+{
+    int row;
+    const uint8_t *p;
+
+    sg_yuv_init();
+
+    p = (const uint8_t *)pix;
+
+    for (row = 0; row < h; row += 2) {
+        const uint32_t *p0, *p1;
+        uint8_t *y1;
+
+        p0 = (const uint32_t *)(p + row*stride);
+        p1 = p0;
+        y1 = NULL;
+
+        if (row + 1 < h) {
+            p1 = (const uint32_t *)(p + (row + 1)*stride);
+            y1 = y + (row + 1)*ystride;
+        }
+
+        rowpair420(p0, p1, w,
+                   y + row*ystride, y1,
+                   u + (row/2)*ustride,
+                   v + (row/2)*vstride);
+    }
+}
+
+/*
+ * NV12 is 4:2:0 with the chroma planes interleaved. Chroma is
+ * made in column chunks on the stack, then interleaved.
+ */
+
+#define NV12_CHUNK 256
+
+void sg_yuv_nv12(const uint32_t *pix, int stride,
+                 int w, int h,
+                 uint8_t *y, int ystride,
+                 uint8_t *uv, int uvstride)
+{
+    int row;
+    const uint8_t *p;
+    uint8_t u[NV12_CHUNK], v[NV12_CHUNK];
+
+    sg_yuv_init();
+
+    p = (const uint8_t *)pix;
+
+    for (row = 0; row < h; row += 2) {
+        const uint32_t *p0, *p1;
+        uint8_t *y0, *y1;
+        uint8_t *out;
+        int x0;
+
+        p0 = (const uint32_t *)(p + row*stride);
+        p1 = p0;
+        y0 = y + row*ystride;
+        y1 = NULL;
+
+        if (row + 1 < h) {
+            p1 = (const uint32_t *)(p + (row + 1)*stride);
+            y1 = y + (row + 1)*ystride;
+        }
+
+        out = uv + (row/2)*uvstride;
+
+        /* chunks are an even number of pixels, bar the last */
+        for (x0 = 0; x0 < w; x0 += 2*NV12_CHUNK) {
+            int n, cw, x;
+
+            n = w - x0;
+            if (n > 2*NV12_CHUNK) n = 2*NV12_CHUNK;
+            cw = (n + 1) / 2;
+
+            rowpair420(p0 + x0, p1 + x0, n,
+                       y0 + x0, y1 == NULL ? NULL : y1 + x0,
+                       u, v);
+
+            for (x = 0; x < cw; x++) {
+                out[x0 + 2*x] = u[x];
+                out[x0 + 2*x + 1] = v[x];
+            }
+        }
+    }
+}
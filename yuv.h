@@ -0,0 +1,21 @@
+#ifndef SG_YUV_H
+#define SG_YUV_H
+void sg_yuv_init(void);
+
+void sg_yuv444(const uint32_t *pix, int stride,
+               int w, int h,
+               uint8_t *y, int ystride,
+               uint8_t *u, int ustride,
+               uint8_t *v, int vstride);
+
+void sg_yuv420(const uint32_t *pix, int stride,
+               int w, int h,
+               uint8_t *y, int ystride,
+               uint8_t *u, int ustride,
+               uint8_t *v, int vstride);
+
+void sg_yuv_nv12(const uint32_t *pix, int stride,
+                 int w, int h,
+                 uint8_t *y, int ystride,
+                 uint8_t *uv, int uvstride);
+#endif